@@ -0,0 +1,355 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "Processing.hpp"
+
+/**
+ * Benchmark of the detection pipeline over the Test/ images.
+ *
+ * Each pipeline stage and the whole detector are measured separately (median and 99th
+ * percentile of the repetitions). Detected groups can be recorded to or verified against
+ * expected results file, so the optimizations can be checked for correctness too. Results of
+ * the reduced decode path are stored separately (with FAST_RESULTS_SUFFIX), because the
+ * first pass at reduced resolution may find different boxes.
+ */
+
+#ifndef POBR_TEST_DIR
+#define POBR_TEST_DIR "Test"
+#endif
+
+#define FAST_RESULTS_SUFFIX "@fast"
+
+const char* gTestImages[] =
+{
+    "1.jpg", "2.jpg", "3.jpg", "4.jpg", "5.jpg", "6.jpg", "7.jpg", "8.JPG", "9.jpg", "10.jpg", "11.jpg",
+    "basic2.bmp",
+};
+
+struct Options
+{
+    std::string dataDir;
+    std::string recordFile;
+    std::string checkFile;
+    int warmup;
+    int repetitions;
+    int upscale;
+
+    Options()
+        : dataDir(POBR_TEST_DIR)
+        , warmup(2)
+        , repetitions(10)
+        , upscale(2)
+    {
+    }
+};
+
+struct BenchImage
+{
+    std::string name;
+    std::vector<uchar> encoded; // file content (empty for synthetic images)
+    cv::Mat image;
+};
+
+typedef std::map<std::string, std::vector<GroupBox>> ResultsMap;
+
+/**
+ * Run a function "warmup + repetitions" times and print timing statistics (in milliseconds).
+ */
+template <typename Func>
+void Measure(const Options& options, const std::string& imageName, const char* stage, Func func)
+{
+    for (int i = 0; i < options.warmup; ++i)
+        func();
+
+    std::vector<double> samples;
+    samples.reserve(options.repetitions);
+    for (int i = 0; i < options.repetitions; ++i)
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        auto end = std::chrono::high_resolution_clock::now();
+        samples.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    size_t p99Index = (samples.size() * 99 + 99) / 100 - 1; // nearest-rank percentile
+    double median = samples[samples.size() / 2];
+    double p99 = samples[std::min(p99Index, samples.size() - 1)];
+
+    std::cout << std::left << std::setw(20) << imageName << std::setw(14) << stage << std::right <<
+        std::fixed << std::setprecision(3) <<
+        std::setw(12) << median << std::setw(12) << p99 <<
+        std::setw(12) << samples.front() << std::endl;
+}
+
+void BenchmarkImage(const Options& options, const BenchImage& input, ResultsMap& results)
+{
+    static ThreadPool serialPool(1);
+
+    /// prepare inputs of each stage
+    cv::Mat sharpened = Sharpen(input.image);
+    cv::Mat binaryImage = Preprocess(sharpened, COLOR_TRESHOLD);
+    std::vector<Segment*> segments;
+    CalculatePixelGroups(binaryImage, segments);
+    std::vector<Segment*> letterCandidates;
+    FindLetterCandidates(segments, letterCandidates);
+
+    Measure(options, input.name, "sharpen", [&]()
+    {
+        Sharpen(input.image);
+    });
+
+    Measure(options, input.name, "preprocess", [&]()
+    {
+        Preprocess(sharpened, COLOR_TRESHOLD);
+    });
+
+    Measure(options, input.name, "labeling", [&]()
+    {
+        std::vector<Segment*> tmpSegments;
+        CalculatePixelGroups(binaryImage, tmpSegments);
+        FreeSegments(tmpSegments);
+    });
+
+    Measure(options, input.name, "classify", [&]()
+    {
+        std::vector<Segment*> tmpCandidates;
+        FindLetterCandidates(segments, tmpCandidates);
+    });
+
+    Measure(options, input.name, "classify-1t", [&]()
+    {
+        std::vector<char> flags;
+        ClassifySegments(segments, flags, serialPool);
+    });
+
+    Measure(options, input.name, "moments-all", [&]()
+    {
+        for (const Segment* seg : segments)
+            seg->CalculateMoments<MOMENT_ALL>();
+    });
+
+    Measure(options, input.name, "moments-class", [&]()
+    {
+        for (const Segment* seg : segments)
+            seg->CalculateMoments<MOMENT_CLASSIFIER>();
+    });
+
+    Measure(options, input.name, "groupping", [&]()
+    {
+        std::vector<SegmentGroup> groups;
+        std::vector<GroupBox> boxes;
+        PerformSegmentGroupping(letterCandidates, groups);
+        FindValidGroups(groups, boxes);
+    });
+
+    Measure(options, input.name, "end-to-end", [&]()
+    {
+        DetectGroups(input.image, results[input.name]);
+    });
+
+    if (!input.encoded.empty())
+    {
+        Measure(options, input.name, "decode", [&]()
+        {
+            cv::imdecode(cv::Mat(input.encoded), cv::IMREAD_COLOR);
+        });
+
+        Measure(options, input.name, "fast-detect", [&]()
+        {
+            DetectGroupsInEncoded(input.encoded.data(), input.encoded.size(), nullptr,
+                                  results[input.name + FAST_RESULTS_SUFFIX], true);
+        });
+    }
+
+    FreeSegments(segments);
+}
+
+bool LoadResults(const std::string& fileName, ResultsMap& results)
+{
+    std::ifstream file(fileName);
+    if (!file.good())
+        return false;
+
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        std::istringstream stream(line);
+        std::string name;
+        size_t count = 0;
+        stream >> name >> count;
+
+        std::vector<GroupBox>& boxes = results[name];
+        boxes.resize(count);
+        for (GroupBox& box : boxes)
+            stream >> box.minx >> box.miny >> box.maxx >> box.maxy;
+
+        if (stream.fail())
+        {
+            std::cout << "Malformed line in " << fileName << ": " << line << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool SaveResults(const std::string& fileName, const ResultsMap& results)
+{
+    std::ofstream file(fileName);
+    if (!file.good())
+        return false;
+
+    file << "# image groups_count [minx miny maxx maxy]..." << std::endl;
+    for (const auto& result : results)
+    {
+        const std::vector<GroupBox>& boxes = result.second;
+        file << result.first << ' ' << boxes.size();
+        for (const GroupBox& box : boxes)
+            file << ' ' << box.minx << ' ' << box.miny << ' ' << box.maxx << ' ' << box.maxy;
+        file << std::endl;
+    }
+
+    return file.good();
+}
+
+bool SameBoxes(const std::vector<GroupBox>& a, const std::vector<GroupBox>& b)
+{
+    if (a.size() != b.size())
+        return false;
+
+    for (size_t i = 0; i < a.size(); ++i)
+    {
+        if (a[i].minx != b[i].minx || a[i].miny != b[i].miny ||
+            a[i].maxx != b[i].maxx || a[i].maxy != b[i].maxy)
+            return false;
+    }
+
+    return true;
+}
+
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = (i + 1 < argc);
+
+        if (arg == "--data" && hasValue)
+            options.dataDir = argv[++i];
+        else if (arg == "--warmup" && hasValue)
+            options.warmup = std::max(0, atoi(argv[++i]));
+        else if (arg == "--reps" && hasValue)
+            options.repetitions = std::max(1, atoi(argv[++i]));
+        else if (arg == "--upscale" && hasValue)
+            options.upscale = std::max(1, atoi(argv[++i]));
+        else if (arg == "--record" && hasValue)
+            options.recordFile = argv[++i];
+        else if (arg == "--check" && hasValue)
+            options.checkFile = argv[++i];
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [--data <dir>] [--warmup <n>] [--reps <n>]"
+                " [--upscale <factor>] [--record <file> | --check <file>]" << std::endl;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options))
+        return -1;
+
+    gVerbose = false;
+
+    /// load test images (and their upscaled versions)
+    std::vector<BenchImage> images;
+    for (const char* name : gTestImages)
+    {
+        BenchImage input;
+        input.name = name;
+        if (ReadFileContent(options.dataDir + '/' + name, input.encoded))
+            input.image = cv::imdecode(cv::Mat(input.encoded), cv::IMREAD_COLOR);
+        if (input.image.empty())
+        {
+            std::cout << "Could not open or find the image: " << name << std::endl;
+            return 1;
+        }
+        images.push_back(input);
+
+        if (options.upscale > 1)
+        {
+            BenchImage upscaled;
+            upscaled.name = input.name + '@' + std::to_string(options.upscale) + 'x';
+            cv::resize(input.image, upscaled.image,
+                       cv::Size(input.image.cols * options.upscale, input.image.rows * options.upscale),
+                       0.0, 0.0, cv::INTER_CUBIC);
+            images.push_back(upscaled);
+        }
+    }
+
+    std::cout << "warmup = " << options.warmup << ", repetitions = " << options.repetitions <<
+        ", times in [ms]" << std::endl;
+    std::cout << std::left << std::setw(20) << "image" << std::setw(14) << "stage" << std::right <<
+        std::setw(12) << "median" << std::setw(12) << "p99" << std::setw(12) << "min" << std::endl;
+
+    ResultsMap results;
+    for (const BenchImage& input : images)
+        BenchmarkImage(options, input, results);
+
+    if (!options.recordFile.empty())
+    {
+        if (!SaveResults(options.recordFile, results))
+        {
+            std::cout << "Failed to write expected results to " << options.recordFile << std::endl;
+            return 1;
+        }
+        std::cout << "Expected results written to " << options.recordFile << std::endl;
+    }
+
+    if (!options.checkFile.empty())
+    {
+        ResultsMap expected;
+        if (!LoadResults(options.checkFile, expected))
+        {
+            std::cout << "Failed to read expected results from " << options.checkFile << std::endl;
+            return 1;
+        }
+
+        // both the end-to-end and the reduced decode results are checked
+        int failures = 0;
+        for (const auto& result : results)
+        {
+            auto it = expected.find(result.first);
+            if (it == expected.end())
+            {
+                std::cout << "MISSING  " << result.first << std::endl;
+                failures++;
+            }
+            else if (!SameBoxes(it->second, result.second))
+            {
+                std::cout << "MISMATCH " << result.first << ": expected " << it->second.size() <<
+                    " groups, detected " << result.second.size() << std::endl;
+                failures++;
+            }
+        }
+
+        std::cout << "Correctness check: " << (results.size() - failures) << '/' << results.size() <<
+            " results match" << std::endl;
+        if (failures > 0)
+            return 1;
+    }
+
+    return 0;
+}
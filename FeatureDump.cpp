@@ -0,0 +1,75 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "FeatureFile.hpp"
+
+/**
+ * Converts binary features file (written with --features option) to CSV.
+ */
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cout << "Usage: " << argv[0] << " <features file> [output CSV file]" << std::endl;
+        return -1;
+    }
+
+    FeatureReader reader;
+    if (!reader.Open(argv[1]))
+    {
+        std::cerr << "Could not open or parse the features file" << std::endl;
+        return 1;
+    }
+
+    std::ofstream outputFile;
+    if (argc > 2)
+    {
+        outputFile.open(argv[2]);
+        if (!outputFile.good())
+        {
+            std::cerr << "Could not create the output file" << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& o = (argc > 2) ? outputFile : std::cout;
+
+    o << "image";
+    for (int i = FEATURE_MINX; i < FEATURE_INT_COLUMNS; ++i)
+        o << ',' << FeatureIntColumnName(i);
+    for (int i = 0; i < FEATURE_REAL_COLUMNS; ++i)
+        o << ',' << FeatureRealColumnName(i);
+    o << '\n';
+
+    const std::vector<std::string>& imageNames = reader.GetImageNames();
+    o << std::setprecision(10);
+    for (const FeatureBlock& block : reader.GetBlocks())
+    {
+        for (size_t i = 0; i < block.recordsNum; ++i)
+        {
+            int imageId = block.integer[FEATURE_IMAGE][i];
+            if (imageId >= 0 && imageId < (int)imageNames.size())
+            {
+                // quote the name (it can contain commas)
+                o << '"';
+                for (char c : imageNames[imageId])
+                    o << (c == '"' ? "\"\"" : std::string(1, c));
+                o << '"';
+            }
+            else
+                o << imageId;
+
+            for (int j = FEATURE_MINX; j < FEATURE_INT_COLUMNS; ++j)
+                o << ',' << block.integer[j][i];
+            for (int j = 0; j < FEATURE_REAL_COLUMNS; ++j)
+                o << ',' << block.real[j][i];
+            o << '\n';
+        }
+    }
+
+    o.flush();
+    return o.good() ? 0 : 1;
+}
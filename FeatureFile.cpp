@@ -0,0 +1,295 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "FeatureFile.hpp"
+
+#define FEATURE_FILE_MAGIC "POBRFEAT"
+#define FEATURE_COLUMN_NAME_LENGTH 16
+
+#define FEATURE_BLOCK_TYPE_RECORDS 1
+#define FEATURE_BLOCK_TYPE_IMAGE 2
+
+struct FeatureFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t realColumns;
+    uint32_t intColumns;
+    uint32_t blockRecords;
+    // followed by column names (real columns first)
+};
+
+struct FeatureBlockHeader
+{
+    uint32_t type;
+    uint32_t count;       // number of records or image name length
+    uint64_t payloadSize; // multiple of 8 bytes, so the columns stay aligned
+};
+
+const char* gFeatureRealColumnNames[FEATURE_REAL_COLUMNS] =
+{
+    "S", "L", "I1", "I2", "I3", "I4", "I5", "I6", "I7", "I8", "I9", "I10", "W9",
+};
+
+const char* gFeatureIntColumnNames[FEATURE_INT_COLUMNS] =
+{
+    "image", "minx", "miny", "maxx", "maxy", "class",
+};
+
+const char* FeatureRealColumnName(int column)
+{
+    return gFeatureRealColumnNames[column];
+}
+
+const char* FeatureIntColumnName(int column)
+{
+    return gFeatureIntColumnNames[column];
+}
+
+inline size_t AlignTo8(size_t size)
+{
+    return (size + 7) & ~(size_t)7;
+}
+
+/**
+ * Build file header together with the column names.
+ */
+std::vector<char> CreateFeatureFileHeader()
+{
+    std::vector<char> data(sizeof(FeatureFileHeader) +
+                           (FEATURE_REAL_COLUMNS + FEATURE_INT_COLUMNS) * FEATURE_COLUMN_NAME_LENGTH, 0);
+
+    FeatureFileHeader header;
+    memcpy(header.magic, FEATURE_FILE_MAGIC, sizeof(header.magic));
+    header.version = FEATURE_FILE_VERSION;
+    header.realColumns = FEATURE_REAL_COLUMNS;
+    header.intColumns = FEATURE_INT_COLUMNS;
+    header.blockRecords = FEATURE_BLOCK_RECORDS;
+    memcpy(data.data(), &header, sizeof(header));
+
+    char* names = data.data() + sizeof(header);
+    for (int i = 0; i < FEATURE_REAL_COLUMNS; ++i, names += FEATURE_COLUMN_NAME_LENGTH)
+        strncpy(names, gFeatureRealColumnNames[i], FEATURE_COLUMN_NAME_LENGTH - 1);
+    for (int i = 0; i < FEATURE_INT_COLUMNS; ++i, names += FEATURE_COLUMN_NAME_LENGTH)
+        strncpy(names, gFeatureIntColumnNames[i], FEATURE_COLUMN_NAME_LENGTH - 1);
+
+    return data;
+}
+
+SegmentFeatures::SegmentFeatures(int imageId, const Segment& segment, const Moments& moments,
+                                 int classification)
+    : imageId(imageId)
+    , minx(segment.minx)
+    , miny(segment.miny)
+    , maxx(segment.maxx)
+    , maxy(segment.maxy)
+    , moments(moments)
+    , classification(classification)
+{
+}
+
+
+/// FeatureWriter
+
+FeatureWriter::FeatureWriter()
+    : imagesNum(0)
+{
+}
+
+FeatureWriter::~FeatureWriter()
+{
+    Close();
+}
+
+bool FeatureWriter::Open(const std::string& fileName)
+{
+    Close();
+    imagesNum = 0;
+
+    std::vector<char> header = CreateFeatureFileHeader();
+    bool append = false;
+
+    // existing file must be valid to append to it (image ids are continued)
+    {
+        MappedFile existingFile;
+        bool exists = existingFile.Open(fileName) && existingFile.GetSize() > 0;
+        existingFile.Close();
+
+        if (exists)
+        {
+            FeatureReader reader;
+            if (!reader.Open(fileName))
+                return false;
+
+            imagesNum = static_cast<int>(reader.GetImageNames().size());
+            append = true;
+        }
+    }
+
+    file.open(fileName, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    if (!file.good())
+        return false;
+
+    if (!append)
+        file.write(header.data(), header.size());
+
+    buffer.reserve(FEATURE_BLOCK_RECORDS);
+    return file.good();
+}
+
+int FeatureWriter::AddImage(const std::string& name)
+{
+    // records of the previous image are written first
+    if (!file.is_open() || !Flush())
+        return -1;
+
+    FeatureBlockHeader header;
+    header.type = FEATURE_BLOCK_TYPE_IMAGE;
+    header.count = static_cast<uint32_t>(name.size());
+    header.payloadSize = AlignTo8(name.size());
+
+    std::vector<char> payload(static_cast<size_t>(header.payloadSize), 0);
+    std::copy(name.begin(), name.end(), payload.begin());
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), payload.size());
+    if (!file.good())
+        return -1;
+
+    return imagesNum++;
+}
+
+void FeatureWriter::Write(const SegmentFeatures& features)
+{
+    buffer.push_back(features);
+    if (buffer.size() >= FEATURE_BLOCK_RECORDS)
+        Flush();
+}
+
+bool FeatureWriter::Flush()
+{
+    if (buffer.empty() || !file.is_open())
+        return file.good();
+
+    const size_t num = buffer.size();
+    FeatureBlockHeader header;
+    header.type = FEATURE_BLOCK_TYPE_RECORDS;
+    header.count = static_cast<uint32_t>(num);
+    header.payloadSize = AlignTo8(num * (FEATURE_REAL_COLUMNS * sizeof(double) +
+                                         FEATURE_INT_COLUMNS * sizeof(int32_t)));
+
+    std::vector<char> payload(static_cast<size_t>(header.payloadSize), 0);
+    double* real = reinterpret_cast<double*>(payload.data());
+    for (size_t i = 0; i < num; ++i)
+    {
+        const Moments& moments = buffer[i].moments;
+        real[FEATURE_S * num + i] = moments.S;
+        real[FEATURE_L * num + i] = moments.L;
+        for (int j = 0; j < 10; ++j)
+            real[(FEATURE_I1 + j) * num + i] = moments.I[j + 1];
+        real[FEATURE_W9 * num + i] = moments.W9;
+    }
+
+    int32_t* integer = reinterpret_cast<int32_t*>(real + FEATURE_REAL_COLUMNS * num);
+    for (size_t i = 0; i < num; ++i)
+    {
+        const SegmentFeatures& features = buffer[i];
+        integer[FEATURE_IMAGE * num + i] = features.imageId;
+        integer[FEATURE_MINX * num + i] = features.minx;
+        integer[FEATURE_MINY * num + i] = features.miny;
+        integer[FEATURE_MAXX * num + i] = features.maxx;
+        integer[FEATURE_MAXY * num + i] = features.maxy;
+        integer[FEATURE_CLASS * num + i] = features.classification;
+    }
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(payload.data(), payload.size());
+    buffer.clear();
+    return file.good();
+}
+
+bool FeatureWriter::Close()
+{
+    if (!file.is_open())
+        return true;
+
+    bool result = Flush();
+    file.close();
+    return result && !file.fail();
+}
+
+
+/// FeatureReader
+
+FeatureReader::FeatureReader()
+    : recordsNum(0)
+{
+}
+
+bool FeatureReader::Open(const std::string& fileName)
+{
+    imageNames.clear();
+    blocks.clear();
+    recordsNum = 0;
+
+    if (!mappedFile.Open(fileName))
+        return false;
+
+    const uchar* data = mappedFile.GetData();
+    const size_t size = mappedFile.GetSize();
+
+    // header and column names must match exactly
+    std::vector<char> header = CreateFeatureFileHeader();
+    if (size < header.size() || memcmp(data, header.data(), header.size()) != 0)
+        return false;
+
+    size_t offset = header.size();
+    while (offset < size)
+    {
+        FeatureBlockHeader blockHeader;
+        if (offset + sizeof(blockHeader) > size)
+            return false;
+        memcpy(&blockHeader, data + offset, sizeof(blockHeader));
+        offset += sizeof(blockHeader);
+
+        if (blockHeader.payloadSize > size - offset || blockHeader.payloadSize % 8 != 0)
+            return false;
+        const uchar* payload = data + offset;
+
+        if (blockHeader.type == FEATURE_BLOCK_TYPE_IMAGE)
+        {
+            if (blockHeader.count > blockHeader.payloadSize)
+                return false;
+            imageNames.push_back(std::string(reinterpret_cast<const char*>(payload), blockHeader.count));
+        }
+        else if (blockHeader.type == FEATURE_BLOCK_TYPE_RECORDS)
+        {
+            const size_t num = blockHeader.count;
+            if (num * (FEATURE_REAL_COLUMNS * sizeof(double) + FEATURE_INT_COLUMNS * sizeof(int32_t)) >
+                blockHeader.payloadSize)
+                return false;
+
+            FeatureBlock block;
+            block.recordsNum = num;
+            const double* real = reinterpret_cast<const double*>(payload);
+            for (int i = 0; i < FEATURE_REAL_COLUMNS; ++i)
+                block.real[i] = real + i * num;
+            const int32_t* integer = reinterpret_cast<const int32_t*>(real + FEATURE_REAL_COLUMNS * num);
+            for (int i = 0; i < FEATURE_INT_COLUMNS; ++i)
+                block.integer[i] = integer + i * num;
+
+            blocks.push_back(block);
+            recordsNum += num;
+        }
+        else
+            return false;
+
+        offset += static_cast<size_t>(blockHeader.payloadSize);
+    }
+
+    return true;
+}
@@ -0,0 +1,139 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#pragma once
+
+#include "Segment.hpp"
+#include "MappedFile.hpp"
+
+/**
+ * Binary file of per-segment features.
+ *
+ * The file consists of a header (with column descriptors) and a sequence of blocks.
+ * Image blocks assign consecutive ids to the image names, record blocks store up to
+ * FEATURE_BLOCK_RECORDS records column by column (all the real columns first, then
+ * the integer ones), so the columns can be used directly from the memory-mapped file.
+ */
+
+#define FEATURE_FILE_VERSION 1
+#define FEATURE_BLOCK_RECORDS 4096
+
+/// real (64-bit floating point) columns
+#define FEATURE_S 0
+#define FEATURE_L 1
+#define FEATURE_I1 2    // I1..I10 are stored in consecutive columns
+#define FEATURE_W9 12
+#define FEATURE_REAL_COLUMNS 13
+
+/// integer (32-bit) columns
+#define FEATURE_IMAGE 0
+#define FEATURE_MINX 1
+#define FEATURE_MINY 2
+#define FEATURE_MAXX 3
+#define FEATURE_MAXY 4
+#define FEATURE_CLASS 5
+#define FEATURE_INT_COLUMNS 6
+
+/**
+ * Features of a single segment.
+ */
+struct SegmentFeatures
+{
+    int imageId;
+    int minx;
+    int miny;
+    int maxx;
+    int maxy;
+    Moments moments;
+    int classification;
+
+    SegmentFeatures(int imageId, const Segment& segment, const Moments& moments, int classification);
+};
+
+/**
+ * View of a record block in the mapped file.
+ */
+struct FeatureBlock
+{
+    size_t recordsNum;
+    const double* real[FEATURE_REAL_COLUMNS];
+    const int32_t* integer[FEATURE_INT_COLUMNS];
+};
+
+/**
+ * Name of a column (as used in CSV header).
+ */
+const char* FeatureRealColumnName(int column);
+const char* FeatureIntColumnName(int column);
+
+/**
+ * Writes features with buffered appends.
+ */
+class FeatureWriter
+{
+private:
+    std::ofstream file;
+    std::vector<SegmentFeatures> buffer;
+    int imagesNum;
+
+    bool Flush();
+
+    FeatureWriter(const FeatureWriter&);
+    FeatureWriter& operator=(const FeatureWriter&);
+
+public:
+    FeatureWriter();
+    ~FeatureWriter();
+
+    /**
+     * Open features file. Records are appended if the file already exists.
+     */
+    bool Open(const std::string& fileName);
+
+    /**
+     * Start records of a new image. Returns image id or -1 if the file could not be written.
+     */
+    int AddImage(const std::string& name);
+
+    void Write(const SegmentFeatures& features);
+
+    /**
+     * Write buffered records and close the file.
+     */
+    bool Close();
+};
+
+/**
+ * Reads features from the memory-mapped file.
+ */
+class FeatureReader
+{
+private:
+    MappedFile mappedFile;
+    std::vector<std::string> imageNames;
+    std::vector<FeatureBlock> blocks;
+    size_t recordsNum;
+
+public:
+    FeatureReader();
+
+    bool Open(const std::string& fileName);
+
+    const std::vector<std::string>& GetImageNames() const
+    {
+        return imageNames;
+    }
+
+    const std::vector<FeatureBlock>& GetBlocks() const
+    {
+        return blocks;
+    }
+
+    size_t GetRecordsNum() const
+    {
+        return recordsNum;
+    }
+};
@@ -0,0 +1,144 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "Groupping.hpp"
+
+/**
+ * Regression test of the letter group scoring (ScoreSegmentGroup) on synthetic groups.
+ *
+ * Letters are represented only by their bounding boxes, so no images are needed. The expected
+ * scores guard the GROUP_* constants: retuning them must keep these cases accepted or rejected.
+ */
+
+#define LETTER_WIDTH 20
+#define LETTER_HEIGHT 30
+#define LETTER_GAP 6
+
+struct TestGroup
+{
+    std::vector<Segment> segments;
+
+    void Add(double centerX, double centerY, double width, double height)
+    {
+        Segment seg;
+        seg.minx = (int)std::floor(centerX - 0.5 * width + 0.5);
+        seg.miny = (int)std::floor(centerY - 0.5 * height + 0.5);
+        seg.maxx = seg.minx + (int)(width + 0.5) - 1;
+        seg.maxy = seg.miny + (int)(height + 0.5) - 1;
+        segments.push_back(seg);
+    }
+
+    SegmentGroup Get()
+    {
+        SegmentGroup group;
+        for (Segment& seg : segments)
+            group.push_back(&seg);
+        return group;
+    }
+};
+
+/**
+ * Line of letters rotated by given angle (bounding boxes of the rotated letters).
+ */
+TestGroup MakeLine(int lettersNum, double angleDegrees)
+{
+    const double angle = angleDegrees * 3.14159265358979 / 180.0;
+    const double c = std::abs(cos(angle)), s = std::abs(sin(angle));
+    const double step = LETTER_WIDTH + LETTER_GAP;
+
+    TestGroup result;
+    for (int i = 0; i < lettersNum; ++i)
+        result.Add(500.0 + i * step * cos(angle), 500.0 + i * step * sin(angle),
+                   LETTER_WIDTH * c + LETTER_HEIGHT * s, LETTER_WIDTH * s + LETTER_HEIGHT * c);
+    return result;
+}
+
+int gFailures = 0;
+
+void Check(const char* name, TestGroup group, double minScore, double maxScore)
+{
+    double score = ScoreSegmentGroup(group.Get());
+    bool ok = (score >= minScore && score <= maxScore);
+    if (!ok)
+        gFailures++;
+
+    std::cout << (ok ? "PASS  " : "FAIL  ") << std::left << std::setw(28) << name << std::right <<
+        "score = " << std::fixed << std::setprecision(3) << score <<
+        " (expected " << minScore << " .. " << maxScore << ")" << std::endl;
+}
+
+int main()
+{
+    /// accepted lines (straight and rotated)
+    Check("straight line", MakeLine(7, 0.0), 0.99, 1.0);
+    Check("line rotated by 15 deg", MakeLine(7, 15.0), 0.9, 1.0);
+    Check("line rotated by -15 deg", MakeLine(7, -15.0), 0.9, 1.0);
+    Check("vertical line", MakeLine(7, 90.0), 0.99, 1.0);
+    {
+        // members are ordered by the scoring, not by the caller
+        TestGroup group = MakeLine(7, 15.0);
+        std::reverse(group.segments.begin(), group.segments.end());
+        std::swap(group.segments[1], group.segments[5]);
+        Check("line in random order", group, 0.9, 1.0);
+    }
+
+    /// one missing, merged or split letter
+    Check("missing letter", MakeLine(6, 0.0), 0.6, 0.7);
+    {
+        // the middle letter is split into two halves
+        TestGroup group = MakeLine(7, 0.0);
+        Segment& middle = group.segments[3];
+        Segment right = middle;
+        middle.maxx = (middle.minx + middle.maxx) / 2 - 1;
+        right.minx = middle.maxx + 2;
+        group.segments.push_back(right);
+        Check("split letter", group, 0.6, 0.7);
+    }
+
+    /// rejected groups
+    Check("too few letters", MakeLine(5, 0.0), 0.0, 0.0);
+    Check("too many letters", MakeLine(9, 0.0), 0.0, 0.0);
+    {
+        TestGroup group = MakeLine(7, 0.0);
+        group.segments[4].miny += 3 * LETTER_HEIGHT / 2;
+        group.segments[4].maxy += 3 * LETTER_HEIGHT / 2;
+        Check("off-baseline letter", group, 0.0, 0.0);
+    }
+    {
+        TestGroup group = MakeLine(7, 0.0);
+        group.segments[2].miny -= LETTER_HEIGHT / 2;
+        group.segments[2].maxy += LETTER_HEIGHT / 2;
+        Check("too tall letter", group, 0.0, 0.0);
+    }
+    {
+        TestGroup group = MakeLine(7, 0.0);
+        for (int i = 4; i < 7; ++i)
+        {
+            group.segments[i].minx += 3 * LETTER_WIDTH;
+            group.segments[i].maxx += 3 * LETTER_WIDTH;
+        }
+        Check("irregular spacing", group, 0.0, 0.0);
+    }
+    {
+        // 3x3 grid with one letter missing
+        TestGroup group;
+        for (int i = 0; i < 8; ++i)
+            group.Add(500.0 + (i % 3) * (LETTER_WIDTH + LETTER_GAP), 500.0 + (i / 3) * (LETTER_HEIGHT + LETTER_GAP),
+                      LETTER_WIDTH, LETTER_HEIGHT);
+        Check("grid", group, 0.0, 0.0);
+    }
+    {
+        TestGroup group;
+        const int scatter[7][2] = { { 0, 0 }, { 90, 40 }, { 30, 110 }, { 150, 10 }, { 60, 70 }, { 170, 120 }, { 120, 60 } };
+        for (const auto& pos : scatter)
+            group.Add(500.0 + pos[0], 500.0 + pos[1], LETTER_WIDTH, LETTER_HEIGHT);
+        Check("scattered letters", group, 0.0, 0.0);
+    }
+
+    std::cout << (gFailures == 0 ? "All group scoring tests passed" : "Group scoring tests failed") << std::endl;
+    return gFailures == 0 ? 0 : 1;
+}
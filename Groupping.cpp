@@ -110,4 +110,132 @@ void PerformSegmentGroupping(std::vector<Segment*>& letterCandidates,
         }
         result.push_back(group);
     }
-}
\ No newline at end of file
+}
+
+struct GroupMember
+{
+    double t;      // position along the principal axis
+    double bottom; // baseline position (along the normal axis)
+    double height; // extent along the normal axis
+    double length; // extent along the principal axis
+
+    bool operator<(const GroupMember& other) const
+    {
+        return t < other.t;
+    }
+};
+
+double Median(double* values, size_t num)
+{
+    std::nth_element(values, values + num / 2, values + num);
+    return values[num / 2];
+}
+
+double ScoreSegmentGroup(const SegmentGroup& group)
+{
+    const size_t num = group.size();
+    const size_t maxNum = GROUP_LETTERS + GROUP_LETTERS_TOLERANCE;
+    if (num + GROUP_LETTERS_TOLERANCE < GROUP_LETTERS || num > maxNum)
+        return 0.0;
+
+    double penalty = GROUP_SIZE_PENALTY * std::abs((int)num - GROUP_LETTERS);
+    if (penalty >= GROUP_MAX_PENALTY)
+        return 0.0;
+
+    /// find principal axis of letter centers
+    double meanX = 0.0, meanY = 0.0;
+    for (const Segment* seg : group)
+    {
+        meanX += 0.5 * (seg->minx + seg->maxx);
+        meanY += 0.5 * (seg->miny + seg->maxy);
+    }
+    meanX /= num;
+    meanY /= num;
+
+    double sxx = 0.0, syy = 0.0, sxy = 0.0;
+    for (const Segment* seg : group)
+    {
+        double dx = 0.5 * (seg->minx + seg->maxx) - meanX;
+        double dy = 0.5 * (seg->miny + seg->maxy) - meanY;
+        sxx += dx * dx;
+        syy += dy * dy;
+        sxy += dx * dy;
+    }
+
+    double angle = 0.5 * atan2(2.0 * sxy, sxx - syy);
+    double ux = cos(angle), uy = sin(angle); // principal axis (reading direction)
+    double vx = -uy, vy = ux;                // normal axis
+
+    /// project members on the axes
+    GroupMember members[maxNum];
+    double heights[maxNum];
+    double bottoms[maxNum];
+    for (size_t i = 0; i < num; ++i)
+    {
+        const Segment* seg = group[i];
+        double w = seg->maxx - seg->minx + 1;
+        double h = seg->maxy - seg->miny + 1;
+        double dx = 0.5 * (seg->minx + seg->maxx) - meanX;
+        double dy = 0.5 * (seg->miny + seg->maxy) - meanY;
+
+        GroupMember& member = members[i];
+        member.t = dx * ux + dy * uy;
+        member.height = std::abs(vx) * w + std::abs(vy) * h;
+        member.length = std::abs(ux) * w + std::abs(uy) * h;
+        member.bottom = dx * vx + dy * vy + 0.5 * member.height;
+
+        heights[i] = member.height;
+        bottoms[i] = member.bottom;
+    }
+
+    std::sort(members, members + num);
+
+    double height = Median(heights, num);
+    double baseline = Median(bottoms, num);
+    if (height <= 0.0)
+        return 0.0;
+
+    // text line must be elongated along the principal axis
+    double length = members[num - 1].t - members[0].t +
+        0.5 * (members[0].length + members[num - 1].length);
+    if (length < GROUP_MIN_ELONGATION * height)
+        return 0.0;
+
+    double gaps[maxNum];
+    for (size_t i = 1; i < num; ++i)
+        gaps[i - 1] = members[i].t - members[i - 1].t - 0.5 * (members[i].length + members[i - 1].length);
+    double gapsSorted[maxNum];
+    std::copy(gaps, gaps + num - 1, gapsSorted);
+    double medianGap = Median(gapsSorted, num - 1);
+
+    /// check letters in the reading order
+    for (size_t i = 0; i < num; ++i)
+    {
+        const GroupMember& member = members[i];
+
+        double heightError = std::abs(member.height - height) / height;
+        if (heightError > GROUP_HEIGHT_TOLERANCE)
+            penalty += heightError - GROUP_HEIGHT_TOLERANCE;
+
+        double baselineError = std::abs(member.bottom - baseline) / height;
+        if (baselineError > GROUP_BASELINE_TOLERANCE)
+            penalty += baselineError - GROUP_BASELINE_TOLERANCE;
+
+        if (i > 0)
+        {
+            double gap = gaps[i - 1] / height;
+            if (gap < -GROUP_MAX_OVERLAP)
+                penalty += -GROUP_MAX_OVERLAP - gap;
+
+            double spacingError = std::abs(gaps[i - 1] - medianGap) / height;
+            if (spacingError > GROUP_SPACING_TOLERANCE)
+                penalty += spacingError - GROUP_SPACING_TOLERANCE;
+        }
+
+        // penalty never decreases, so the group can be rejected early
+        if (penalty >= GROUP_MAX_PENALTY)
+            return 0.0;
+    }
+
+    return 1.0 - penalty / GROUP_MAX_PENALTY;
+}
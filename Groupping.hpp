@@ -14,6 +14,17 @@
 
 typedef std::vector<Segment*> SegmentGroup;
 
+/// group validation parameters
+#define GROUP_LETTERS 7                 // number of letters in the searched logo
+#define GROUP_LETTERS_TOLERANCE 1       // accepted number of split or merged letters
+#define GROUP_SIZE_PENALTY 0.35         // penalty for each missing or extra letter
+#define GROUP_HEIGHT_TOLERANCE 0.3      // accepted letter height deviation (relative to median height)
+#define GROUP_BASELINE_TOLERANCE 0.2    // accepted baseline distance (relative to median height)
+#define GROUP_SPACING_TOLERANCE 0.4     // accepted gap deviation (relative to median height)
+#define GROUP_MAX_OVERLAP 0.25          // accepted overlap of neighbouring letters (relative to median height)
+#define GROUP_MIN_ELONGATION 3.0        // minimum group length to median height ratio
+#define GROUP_MAX_PENALTY 1.0
+
 // Node definition for BFS (Breadth First Search)
 struct Node
 {
@@ -27,4 +38,13 @@ struct Node
 };
 
 void PerformSegmentGroupping(std::vector<Segment*>& letterCandidates,
-                             std::vector<SegmentGroup>& result);
\ No newline at end of file
+                             std::vector<SegmentGroup>& result);
+
+/**
+ * Score group of letter candidates. Members are ordered along the principal axis of the group
+ * (so rotated text is handled), then the baseline, letter heights and spacing are checked.
+ * Penalties are accumulated letter by letter and the group is rejected as soon as
+ * the maximum penalty is exceeded.
+ * @return Score in (0, 1] or 0 if the group is rejected
+ */
+double ScoreSegmentGroup(const SegmentGroup& group);
@@ -0,0 +1,211 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // _WIN32
+
+MappedFile::MappedFile()
+    : data(nullptr)
+    , size(0)
+#ifdef _WIN32
+    , fileHandle(INVALID_HANDLE_VALUE)
+    , mappingHandle(nullptr)
+#endif // _WIN32
+{
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+FileLock::FileLock()
+#ifdef _WIN32
+    : fileHandle(INVALID_HANDLE_VALUE)
+#else
+    : fd(-1)
+#endif // _WIN32
+{
+}
+
+FileLock::~FileLock()
+{
+    Unlock();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    fileHandle = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                             nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(fileHandle, &fileSize))
+    {
+        Close();
+        return false;
+    }
+
+    // empty file can not be mapped
+    if (fileSize.QuadPart == 0)
+        return true;
+
+    mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    data = static_cast<const uchar*>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (data == nullptr)
+    {
+        Close();
+        return false;
+    }
+
+    size = static_cast<size_t>(fileSize.QuadPart);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != nullptr)
+        UnmapViewOfFile(data);
+    if (mappingHandle != nullptr)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+
+    data = nullptr;
+    size = 0;
+    mappingHandle = nullptr;
+    fileHandle = INVALID_HANDLE_VALUE;
+}
+
+bool FileLock::Lock(const std::string& lockFileName)
+{
+    Unlock();
+
+    fileHandle = CreateFileA(lockFileName.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                             nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return false;
+
+    OVERLAPPED overlapped = {};
+    if (!LockFileEx(fileHandle, LOCKFILE_EXCLUSIVE_LOCK, 0, MAXDWORD, MAXDWORD, &overlapped))
+    {
+        CloseHandle(fileHandle);
+        fileHandle = INVALID_HANDLE_VALUE;
+        return false;
+    }
+
+    return true;
+}
+
+void FileLock::Unlock()
+{
+    if (fileHandle == INVALID_HANDLE_VALUE)
+        return;
+
+    OVERLAPPED overlapped = {};
+    UnlockFileEx(fileHandle, 0, MAXDWORD, MAXDWORD, &overlapped);
+    CloseHandle(fileHandle);
+    fileHandle = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& fileName)
+{
+    Close();
+
+    int fd = open(fileName.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    // empty file can not be mapped
+    if (fileStat.st_size > 0)
+    {
+        void* ptr = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (ptr == MAP_FAILED)
+        {
+            close(fd);
+            return false;
+        }
+
+        data = static_cast<const uchar*>(ptr);
+        size = static_cast<size_t>(fileStat.st_size);
+    }
+
+    // the mapping stays valid after closing the descriptor
+    close(fd);
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (data != nullptr)
+        munmap(const_cast<uchar*>(data), size);
+
+    data = nullptr;
+    size = 0;
+}
+
+bool FileLock::Lock(const std::string& lockFileName)
+{
+    Unlock();
+
+    fd = open(lockFileName.c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0)
+        return false;
+
+    // the lock is released when the descriptor is closed (also when the process is killed)
+    if (flock(fd, LOCK_EX) != 0)
+    {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void FileLock::Unlock()
+{
+    if (fd < 0)
+        return;
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    fd = -1;
+}
+
+#endif // _WIN32
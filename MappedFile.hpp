@@ -0,0 +1,81 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#pragma once
+
+/**
+ * Read-only memory mapping of a whole file.
+ */
+class MappedFile
+{
+private:
+    const uchar* data;
+    size_t size;
+
+#ifdef _WIN32
+    void* fileHandle;
+    void* mappingHandle;
+#endif // _WIN32
+
+    MappedFile(const MappedFile&);
+    MappedFile& operator=(const MappedFile&);
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    /**
+     * Map file into memory. Empty file is opened successfully, but has no data.
+     */
+    bool Open(const std::string& fileName);
+
+    /**
+     * Unmap the file.
+     */
+    void Close();
+
+    const uchar* GetData() const
+    {
+        return data;
+    }
+
+    size_t GetSize() const
+    {
+        return size;
+    }
+};
+
+/**
+ * Exclusive lock shared between processes. The lock is held on a separate lock file, so
+ * the protected file can be replaced while the lock is held.
+ */
+class FileLock
+{
+private:
+#ifdef _WIN32
+    void* fileHandle;
+#else
+    int fd;
+#endif // _WIN32
+
+    FileLock(const FileLock&);
+    FileLock& operator=(const FileLock&);
+
+public:
+    FileLock();
+    ~FileLock();
+
+    /**
+     * Acquire the lock (blocks until it is released by other processes).
+     * The lock file is created if it does not exist.
+     */
+    bool Lock(const std::string& lockFileName);
+
+    /**
+     * Release the lock.
+     */
+    void Unlock();
+};
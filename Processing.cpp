@@ -0,0 +1,606 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "Processing.hpp"
+
+bool gVerbose = true;
+
+inline float GrayValue(const cv::Vec3b& color)
+{
+    float fValue = 0.299f * (float)color[2] + 0.587f * (float)color[1] + 0.114f * (float)color[0];
+    if (fValue > 255.0f)
+        fValue = 255.0f;
+    return fValue;
+}
+
+/**
+ * This function preprocesses input image. The following steps are prformed:
+ * 1. Conversion to grayscale and histogram calculation.
+ * 2. Histogram scaling (removing brightest and darkest pixels).
+ * 3. Applying threshold and generating binary image (8UC1 format).
+ */
+cv::Mat Preprocess(const cv::Mat& m, float treshold)
+{
+    assert(3 == m.channels());
+    assert(CV_8UC3 == m.type());
+
+    int histogram[256] = { 0 };
+
+    // convert to grayscale and calculate histogram
+    for (int i = 0; i < m.rows; ++i)
+    {
+        for (int j = 0; j < m.cols; ++j)
+        {
+            float fValue = GrayValue(m.at<cv::Vec3b>(i, j));
+            unsigned char value = (char)(fValue);
+            histogram[value]++;
+        }
+    }
+
+    const int totalPixels = m.rows * m.cols;
+    int counter;
+    int lowScale = 0;
+    int highScale = 255;
+
+    // reject darkest pixels
+    counter = 0;
+    for (int i = 0; i < 256; ++i)
+    {
+        counter += histogram[i];
+        if (counter < totalPixels / HISTOGRAM_CUT)
+            lowScale = i;
+    }
+
+    // reject brightest pixels
+    counter = 0;
+    for (int i = 255; i >= 0; --i)
+    {
+        counter += histogram[i];
+        if (counter < totalPixels / HISTOGRAM_CUT)
+            highScale = i;
+    }
+
+    // generate final binary image 
+    cv::Mat result(m.rows, m.cols, CV_8UC1);
+    for (int i = 0; i < m.rows; ++i)
+    {
+        for (int j = 0; j < m.cols; ++j)
+        {
+            // grayscale is calculated again instead of keeping a temporary float image
+            float value = GrayValue(m.at<cv::Vec3b>(i, j)) / 255.0f;
+            value -= (float)lowScale / 256.0f;
+            value /= (float)(highScale - lowScale) / 256.0f;
+            result.at<uchar>(i, j) = value > treshold ? 255 : 0;
+        }
+    }
+
+    return result;
+}
+
+/**
+* Simple sharpening filter
+*/
+cv::Mat Sharpen(const cv::Mat& m)
+{
+    const float filter[3][3] =
+    {
+        { -1.0f, -2.0f, -1.0f },
+        { -2.0f, 16.0f, -2.0f },
+        { -1.0f, -2.0f, -1.0f },
+    };
+
+    cv::Mat output(m.rows, m.cols, CV_8UC3);
+    for (int i = 0; i < m.rows; ++i)
+    {
+        for (int j = 0; j < m.cols; ++j)
+        {
+            float sumR = 0.0f, sumG = 0.0f, sumB = 0.0f;
+            for (int k = 0; k < 3; ++k)
+                for (int l = 0; l < 3; ++l)
+                {
+                    int y = std::max(0, std::min(m.rows - 1, i + k - 1));
+                    int x = std::max(0, std::min(m.cols - 1, j + l - 1));
+                    cv::Vec3b color = m.at<cv::Vec3b>(y, x);
+                    sumR += filter[k][l] * (float)color[2];
+                    sumG += filter[k][l] * (float)color[1];
+                    sumB += filter[k][l] * (float)color[0];
+                }
+
+            sumR = std::min(255.0f, std::max(0.0f, sumR / 4.0f));
+            sumG = std::min(255.0f, std::max(0.0f, sumG / 4.0f));
+            sumB = std::min(255.0f, std::max(0.0f, sumB / 4.0f));
+
+            output.at<cv::Vec3b>(i, j) = cv::Vec3b((uchar)sumB, (uchar)sumG, (uchar)sumR);
+        }
+    }
+
+    return output;
+}
+
+/**
+ * 
+ */
+void CalculatePixelGroups(const cv::Mat& input, std::vector<Segment*>& outputSegments,
+                          cv::Mat* outputLabels, const cv::Size& frameSize)
+{
+    assert(CV_8UC1 == input.type());
+
+    std::map<int, int> labelAliasMap;
+
+    cv::Mat groupMap(input.rows, input.cols, CV_32SC1);
+    int id = 0;
+
+    for (int i = 0; i < input.rows; ++i)
+    {
+        for (int j = 0; j < input.cols; ++j)
+        {
+            uchar currVal = input.at<uchar>(i, j);
+            bool sameAsLeft = false;
+            bool sameAsTop = false;
+
+            if (i > 0)
+                sameAsTop = (currVal == input.at<uchar>(i - 1, j));
+
+            if (j > 0)
+                sameAsLeft = (currVal == input.at<uchar>(i, j - 1));
+
+            if (sameAsTop && sameAsLeft)
+            {
+                int topLabel = labelAliasMap[groupMap.at<int>(i - 1, j)];
+                int leftLabel = labelAliasMap[groupMap.at<int>(i, j - 1)];
+                if (topLabel != leftLabel)
+                {
+                    int minLabel = std::min(topLabel, leftLabel);
+                    int maxLabel = std::max(topLabel, leftLabel);
+                    groupMap.at<int>(i, j) = minLabel;
+                    labelAliasMap[maxLabel] = minLabel;
+                    continue;
+                }
+            }
+
+            if (sameAsTop)
+            {
+                groupMap.at<int>(i, j) = labelAliasMap[groupMap.at<int>(i - 1, j)];
+            }
+            else if (sameAsLeft)
+            {
+                groupMap.at<int>(i, j) = labelAliasMap[groupMap.at<int>(i, j - 1)];
+            }
+            else // create unique label
+            {
+                int label = id++;
+                groupMap.at<int>(i, j) = label;
+                labelAliasMap[label] = label;
+            }
+        }
+    }
+
+    // create segments for each unique (merged) label
+    std::map<int, Segment*> segments;
+    for (auto label : labelAliasMap)
+    {
+        auto it = segments.find(label.second);
+        if (it == segments.end())
+        {
+            segments[label.second] = new Segment;
+        }
+    }
+
+    // fill segments with pixels (the dense map of merged labels is written only if requested)
+    if (outputLabels != nullptr)
+        outputLabels->create(input.rows, input.cols, CV_32SC1);
+
+    for (int i = 0; i < input.rows; ++i)
+    {
+        // neighbouring pixels usually belong to the same run, so the map lookups are skipped
+        int lastLabel = -1;
+        int finalLabel = -1;
+        Segment* segment = nullptr;
+
+        for (int j = 0; j < input.cols; ++j)
+        {
+            int label = groupMap.at<int>(i, j);
+            if (label != lastLabel)
+            {
+                lastLabel = label;
+                finalLabel = labelAliasMap[label];
+                segment = segments[finalLabel];
+            }
+
+            if (outputLabels != nullptr)
+                outputLabels->at<int>(i, j) = finalLabel;
+            segment->pixels.push_back(Pixel(j, i));
+        }
+    }
+
+    if (gVerbose)
+        std::cout << "Initial pixel groups: " << segments.size() << std::endl;
+
+    // reject invalid segments (too small, too big)
+    cv::Size limitSize = frameSize.area() > 0 ? frameSize : input.size();
+    int rejected = 0;
+    outputSegments.clear();
+    for (auto it : segments)
+    {
+        Segment* segment = it.second;
+        segment->Process();
+        if (segment->CanReject(limitSize.width, limitSize.height))
+        {
+            rejected++;
+            delete segment;
+            continue;
+        }
+
+        outputSegments.push_back(segment);
+    }
+
+    if (gVerbose)
+        std::cout << "Rejected pixel groups: " << rejected << std::endl;
+}
+
+inline int FastRand(int x)
+{
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = ((x >> 16) ^ x) * 0x45d9f3b;
+    x = ((x >> 16) ^ x);
+    return x;
+}
+
+cv::Mat VisualizeSegments(const cv::Size& size, const std::vector<Segment*>& segments)
+{
+    cv::Mat visual(size.height, size.width, CV_8UC3, cv::Scalar::all(0));
+
+    int id = 0;
+    for (const Segment* segment : segments)
+    {
+        int r = FastRand(id);
+        int g = FastRand(id + 171050183);
+        int b = FastRand(id + 101531671);
+        for (const Pixel& p : segment->pixels)
+        {
+            visual.at<cv::Vec3b>(p.y, p.x) = cv::Vec3b(r % 192, g % 192, b % 192);
+        }
+        id++;
+    }
+
+    return visual;
+}
+
+cv::Mat VisualizePixelGroups(const cv::Mat& input)
+{
+    assert(CV_32SC1 == input.type());
+
+    cv::Mat visual(input.rows, input.cols, CV_8UC3, cv::Scalar::all(0));
+    for (int i = 0; i < input.rows; ++i)
+    {
+        for (int j = 0; j < input.cols; ++j)
+        {
+            int groupId = input.at<int>(i, j);
+            int r = FastRand(groupId);
+            int g = FastRand(groupId + 171050183);
+            int b = FastRand(groupId + 101531671);
+            visual.at<cv::Vec3b>(i, j) = cv::Vec3b(r % 256, g % 256, b % 256);
+        }
+    }
+
+    return visual;
+}
+
+void ClassifySegments(const std::vector<Segment*>& segments, std::vector<char>& flags,
+                      ThreadPool& threadPool)
+{
+    flags.assign(segments.size(), 0);
+
+    // estimated classification cost: moments accumulation and perimeter calculation
+    std::vector<std::pair<size_t, size_t>> costs; // cost, segment index
+    costs.reserve(segments.size());
+    size_t totalCost = 0;
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        const Segment* seg = segments[i];
+        size_t area = (size_t)(seg->maxx - seg->minx + 1) * (size_t)(seg->maxy - seg->miny + 1);
+        costs.push_back(std::make_pair(seg->pixels.size() + area, i));
+        totalCost += costs.back().first;
+    }
+
+    if (threadPool.GetThreadsNum() == 1 || totalCost < 2 * CLASSIFY_CHUNK_COST)
+    {
+        for (size_t i = 0; i < segments.size(); ++i)
+            flags[i] = segments[i]->Classify() > 0 ? 1 : 0;
+        return;
+    }
+
+    // the biggest segments go first, so the small ones fill the gaps at the end
+    std::sort(costs.begin(), costs.end(),
+              [](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b)
+              {
+                  return a.first > b.first;
+              });
+
+    // split into chunks of similar cost
+    std::vector<size_t> chunks; // index of the first element of each chunk
+    size_t chunkCost = CLASSIFY_CHUNK_COST;
+    for (size_t i = 0; i < costs.size(); ++i)
+    {
+        if (chunkCost >= CLASSIFY_CHUNK_COST)
+        {
+            chunks.push_back(i);
+            chunkCost = 0;
+        }
+        chunkCost += costs[i].first;
+    }
+    chunks.push_back(costs.size());
+
+    // each segment has its own flag, so no synchronization is needed
+    threadPool.Run(chunks.size() - 1, [&](size_t chunk)
+    {
+        for (size_t i = chunks[chunk]; i < chunks[chunk + 1]; ++i)
+        {
+            size_t index = costs[i].second;
+            flags[index] = segments[index]->Classify() > 0 ? 1 : 0;
+        }
+    });
+}
+
+void FindLetterCandidates(const std::vector<Segment*>& segments,
+                          std::vector<Segment*>& letterCandidates,
+                          std::vector<char>* outputFlags)
+{
+    std::vector<char> flags;
+    ClassifySegments(segments, flags, ThreadPool::GetDefault());
+
+    letterCandidates.clear();
+    for (size_t i = 0; i < segments.size(); ++i)
+        if (flags[i])
+            letterCandidates.push_back(segments[i]);
+
+    if (outputFlags != nullptr)
+        outputFlags->swap(flags);
+}
+
+void FindValidGroups(const std::vector<SegmentGroup>& groups, std::vector<GroupBox>& result)
+{
+    result.clear();
+    for (const auto& group : groups)
+    {
+        if (ScoreSegmentGroup(group) > 0.0)
+        {
+            GroupBox box;
+            box.minx = 1000000;
+            box.miny = 1000000;
+            box.maxx = 0;
+            box.maxy = 0;
+            for (const Segment* seg : group)
+            {
+                box.minx = std::min(box.minx, seg->minx);
+                box.maxx = std::max(box.maxx, seg->maxx);
+                box.miny = std::min(box.miny, seg->miny);
+                box.maxy = std::max(box.maxy, seg->maxy);
+            }
+            result.push_back(box);
+        }
+    }
+}
+
+void DetectGroups(const cv::Mat& original, std::vector<GroupBox>& result)
+{
+    DetectGroups(original, cv::Rect(0, 0, original.cols, original.rows), result);
+}
+
+void DetectGroups(const cv::Mat& original, const cv::Rect& roi, std::vector<GroupBox>& result)
+{
+    // ROI is a view of the input image, the pixels are not copied
+    cv::Mat input = original(roi);
+
+    cv::Mat image = Sharpen(input);
+    cv::Mat binaryImage = Preprocess(image, COLOR_TRESHOLD);
+
+    // size limits are relative to the whole (possibly reduced) image, not the ROI
+    std::vector<Segment*> segments;
+    CalculatePixelGroups(binaryImage, segments, nullptr, original.size());
+
+    std::vector<Segment*> letterCandidates;
+    FindLetterCandidates(segments, letterCandidates);
+
+    std::vector<SegmentGroup> groups;
+    PerformSegmentGroupping(letterCandidates, groups);
+    FindValidGroups(groups, result);
+    TranslateGroups(result, roi.x, roi.y);
+
+    FreeSegments(segments);
+}
+
+bool ClipRoi(const cv::Size& imageSize, const cv::Rect* roi, cv::Rect& result)
+{
+    result = cv::Rect(0, 0, imageSize.width, imageSize.height);
+    if (roi != nullptr)
+        result &= *roi;
+    return result.width > 0 && result.height > 0;
+}
+
+bool DetectGroupsInBuffer(const uchar* data, int width, int height, size_t stride,
+                          const cv::Rect* roi, std::vector<GroupBox>& result)
+{
+    result.clear();
+    if (data == nullptr || width <= 0 || height <= 0 || stride < 3 * (size_t)width)
+        return false;
+
+    // wrap the buffer (the data is only read)
+    cv::Mat image(height, width, CV_8UC3, const_cast<uchar*>(data), stride);
+
+    cv::Rect clippedRoi;
+    if (!ClipRoi(image.size(), roi, clippedRoi))
+        return false;
+
+    DetectGroups(image, clippedRoi, result);
+    return true;
+}
+
+bool DetectGroupsInEncoded(const uchar* data, size_t size, const cv::Rect* roi,
+                           std::vector<GroupBox>& result, bool reducedDecode)
+{
+    result.clear();
+    if (data == nullptr || size == 0)
+        return false;
+
+    cv::Mat encoded(1, (int)size, CV_8UC1, const_cast<uchar*>(data));
+    cv::Rect clippedRoi;
+
+#ifdef REDUCED_DECODE_SUPPORTED
+    int width, height;
+    int factor = 1;
+    if (reducedDecode && ReadJpegSize(data, size, width, height))
+        factor = ChooseDecodeReduction(width, height);
+
+    if (factor > 1)
+    {
+        int flags = (factor == 8) ? cv::IMREAD_REDUCED_COLOR_8 :
+                    (factor == 4) ? cv::IMREAD_REDUCED_COLOR_4 : cv::IMREAD_REDUCED_COLOR_2;
+        cv::Mat image = cv::imdecode(encoded, flags);
+
+        // EXIF orientation may be applied by the decoder, so the frame header size can be transposed
+        cv::Size fullSize(width, height);
+        if (image.cols != (width + factor - 1) / factor)
+            fullSize = cv::Size(height, width);
+
+        if (!image.empty() && ClipRoi(fullSize, roi, clippedRoi))
+        {
+            int x0 = clippedRoi.x / factor;
+            int y0 = clippedRoi.y / factor;
+            int x1 = (clippedRoi.x + clippedRoi.width + factor - 1) / factor;
+            int y1 = (clippedRoi.y + clippedRoi.height + factor - 1) / factor;
+            cv::Rect reducedRoi = cv::Rect(x0, y0, x1 - x0, y1 - y0) & cv::Rect(0, 0, image.cols, image.rows);
+
+            if (reducedRoi.width > 0 && reducedRoi.height > 0)
+            {
+                // reduced ROI is rounded outwards, so the boxes are clipped to the requested ROI
+                DetectGroups(image, reducedRoi, result);
+                ScaleGroups(result, factor, clippedRoi);
+                if (!result.empty())
+                    return true;
+            }
+        }
+
+        // reduced resolution pass is inconclusive - decode the full image
+    }
+#endif // REDUCED_DECODE_SUPPORTED
+
+    cv::Mat image = cv::imdecode(encoded, cv::IMREAD_COLOR);
+    if (image.empty())
+        return false;
+
+    if (!ClipRoi(image.size(), roi, clippedRoi))
+        return false;
+
+    DetectGroups(image, clippedRoi, result);
+    return true;
+}
+
+bool ReadJpegSize(const uchar* data, size_t size, int& width, int& height)
+{
+    // SOI marker
+    if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+        return false;
+
+    size_t pos = 2;
+    while (pos + 4 <= size)
+    {
+        if (data[pos] != 0xFF)
+            return false;
+
+        uchar marker = data[pos + 1];
+        if (marker == 0xFF) // fill byte
+        {
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) // markers without payload
+        {
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) // end of image or start of scan before frame header
+            return false;
+
+        // SOF0..SOF15 (excluding DHT, JPG and DAC markers)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC)
+        {
+            if (pos + 9 > size)
+                return false;
+            height = (data[pos + 5] << 8) | data[pos + 6];
+            width = (data[pos + 7] << 8) | data[pos + 8];
+            return width > 0 && height > 0;
+        }
+
+        size_t length = (data[pos + 2] << 8) | data[pos + 3];
+        pos += 2 + length;
+    }
+
+    return false;
+}
+
+int ChooseDecodeReduction(int width, int height)
+{
+#ifdef REDUCED_DECODE_SUPPORTED
+    // the smallest searched letter must still be bigger than the CanReject() limit after reduction
+    int smallestLetter = std::min(width, height) / REDUCED_DECODE_LETTER_RATIO;
+    int factor = 1;
+    while (factor < 8 && smallestLetter / (2 * factor) > SEGMENT_MIN_SIZE)
+        factor *= 2;
+    return factor;
+#else
+    return 1;
+#endif // REDUCED_DECODE_SUPPORTED
+}
+
+bool ReadFileContent(const std::string& fileName, std::vector<uchar>& content)
+{
+    std::ifstream file(fileName, std::ios::binary | std::ios::ate);
+    if (!file.good())
+        return false;
+
+    std::streamoff size = file.tellg();
+    file.seekg(0, std::ios::beg);
+    content.resize((size_t)size);
+    if (size > 0)
+        file.read(reinterpret_cast<char*>(content.data()), size);
+    return file.good();
+}
+
+void TranslateGroups(std::vector<GroupBox>& boxes, int dx, int dy)
+{
+    for (GroupBox& box : boxes)
+    {
+        box.minx += dx;
+        box.maxx += dx;
+        box.miny += dy;
+        box.maxy += dy;
+    }
+}
+
+void ScaleGroups(std::vector<GroupBox>& boxes, int factor, const cv::Rect& bounds)
+{
+    std::vector<GroupBox> scaled;
+    for (const GroupBox& box : boxes)
+    {
+        GroupBox result;
+        result.minx = std::max(box.minx * factor, bounds.x);
+        result.miny = std::max(box.miny * factor, bounds.y);
+        result.maxx = std::min(box.maxx * factor + factor - 1, bounds.x + bounds.width - 1);
+        result.maxy = std::min(box.maxy * factor + factor - 1, bounds.y + bounds.height - 1);
+        if (result.minx <= result.maxx && result.miny <= result.maxy)
+            scaled.push_back(result);
+    }
+    boxes.swap(scaled);
+}
+
+void FreeSegments(std::vector<Segment*>& segments)
+{
+    for (Segment* seg : segments)
+        delete seg;
+    segments.clear();
+}
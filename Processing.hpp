@@ -0,0 +1,164 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#pragma once
+
+#include "Segment.hpp"
+#include "Groupping.hpp"
+#include "ThreadPool.hpp"
+
+#define HISTOGRAM_CUT 15
+#define COLOR_TRESHOLD 0.5f
+
+// minimum estimated cost (pixels to visit) of a single parallel classification task
+#define CLASSIFY_CHUNK_COST 32768
+
+// version of the detection algorithm (must be increased when the detection results change)
+#define DETECTOR_VERSION 4
+
+// shorter image side divided by this value is the smallest letter size searched in the reduced decode pass
+#define REDUCED_DECODE_LETTER_RATIO 48
+
+// reduced resolution decoding (IMREAD_REDUCED_COLOR_*) is available since OpenCV 3.2
+#if CV_VERSION_MAJOR > 3 || (CV_VERSION_MAJOR == 3 && CV_VERSION_MINOR >= 2)
+#define REDUCED_DECODE_SUPPORTED
+#endif
+
+/**
+ * Detected group of letters (bounding box in the input image coordinates).
+ */
+struct GroupBox
+{
+    int minx;
+    int miny;
+    int maxx;
+    int maxy;
+};
+
+/**
+ * Print statistics of the processing stages to the standard output.
+ */
+extern bool gVerbose;
+
+/**
+ * Preprocess input image (grayscale conversion, histogram scaling and thresholding).
+ * Returns binary image in 8UC1 format.
+ */
+cv::Mat Preprocess(const cv::Mat& m, float treshold = 0.5f);
+
+/**
+ * Simple sharpening filter.
+ */
+cv::Mat Sharpen(const cv::Mat& m);
+
+/**
+ * Extract connected pixel groups from binary image. Segments that can not be letters
+ * are rejected.
+ * @param outputLabels Optional dense map of pixel group labels (32SC1 format), used for debugging
+ * @param frameSize    Size of the whole frame when the input is a region of it. The segment size
+ *                     limits are relative to the frame, so a region does not change the classification.
+ *                     Empty size means the input is the whole frame.
+ */
+void CalculatePixelGroups(const cv::Mat& input, std::vector<Segment*>& outputSegments,
+                          cv::Mat* outputLabels = nullptr, const cv::Size& frameSize = cv::Size());
+
+/**
+ * Classify segments in parallel. flags[i] is set to segments[i]->Classify() result.
+ * Segments are processed in chunks (the biggest first) on the thread pool.
+ */
+void ClassifySegments(const std::vector<Segment*>& segments, std::vector<char>& flags,
+                      ThreadPool& threadPool);
+
+/**
+ * Select segments classified as letters (in the original order).
+ * @param outputFlags Optional classification result of each segment
+ */
+void FindLetterCandidates(const std::vector<Segment*>& segments,
+                          std::vector<Segment*>& letterCandidates,
+                          std::vector<char>* outputFlags = nullptr);
+
+/**
+ * Select groups of letters that match the searched logo.
+ */
+void FindValidGroups(const std::vector<SegmentGroup>& groups, std::vector<GroupBox>& result);
+
+/**
+ * Run the whole detection pipeline on BGR image.
+ */
+void DetectGroups(const cv::Mat& original, std::vector<GroupBox>& result);
+
+/**
+ * Run the whole detection pipeline on a region of BGR image (the region is not copied).
+ * Group boxes are returned in the full image coordinates.
+ */
+void DetectGroups(const cv::Mat& original, const cv::Rect& roi, std::vector<GroupBox>& result);
+
+/**
+ * Clip optional region of interest (nullptr means the whole image) to the image area.
+ * Returns false if the resulting region is empty.
+ */
+bool ClipRoi(const cv::Size& imageSize, const cv::Rect* roi, cv::Rect& result);
+
+/**
+ * Run the detection on raw BGR pixels (8 bits per channel) wrapped without copying.
+ * @param stride Size of image row in bytes
+ * @param roi    Optional region of interest (nullptr means the whole image)
+ */
+bool DetectGroupsInBuffer(const uchar* data, int width, int height, size_t stride,
+                          const cv::Rect* roi, std::vector<GroupBox>& result);
+
+/**
+ * Decode encoded image (e.g. JPEG file content) from memory and run the detection.
+ * @param roi           Optional region of interest (nullptr means the whole image)
+ * @param reducedDecode Run the first pass on JPEG decoded at reduced resolution. The image is
+ *                      decoded at full resolution only if no group was found in the first pass.
+ */
+bool DetectGroupsInEncoded(const uchar* data, size_t size, const cv::Rect* roi,
+                           std::vector<GroupBox>& result, bool reducedDecode = false);
+
+/**
+ * Read image size from JPEG frame header (without decoding the image).
+ */
+bool ReadJpegSize(const uchar* data, size_t size, int& width, int& height);
+
+/**
+ * Choose reduced decode factor (1, 2, 4 or 8) for the image, so the smallest searched
+ * letters still pass the segment size limit.
+ */
+int ChooseDecodeReduction(int width, int height);
+
+/**
+ * Read whole file into memory.
+ */
+bool ReadFileContent(const std::string& fileName, std::vector<uchar>& content);
+
+/**
+ * Move group boxes by given offset (e.g. from ROI to the full image coordinates).
+ */
+void TranslateGroups(std::vector<GroupBox>& boxes, int dx, int dy);
+
+/**
+ * Map group boxes from image decoded at reduced resolution to the full image coordinates.
+ * Boxes are clipped to the bounds (e.g. region of interest), boxes outside of them are removed.
+ */
+void ScaleGroups(std::vector<GroupBox>& boxes, int factor, const cv::Rect& bounds);
+
+/**
+ * Release segments allocated by CalculatePixelGroups.
+ */
+void FreeSegments(std::vector<Segment*>& segments);
+
+/// visualization functions
+
+/**
+ * Draw segments (from their pixel lists) on image of given size.
+ */
+cv::Mat VisualizeSegments(const cv::Size& size, const std::vector<Segment*>& segments);
+
+/**
+ * Draw dense map of pixel group labels.
+ */
+cv::Mat VisualizePixelGroups(const cv::Mat& input);
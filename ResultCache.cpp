@@ -0,0 +1,473 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "ResultCache.hpp"
+
+#define RESULT_CACHE_MAGIC 0x43524250 // "PBRC"
+#define RESULT_CACHE_VERSION 3
+#define RESULT_CACHE_MIN_SIZE 4096
+#define RESULT_CACHE_MIN_SLOTS 16
+#define RESULT_CACHE_BYTES_PER_SLOT 32 // hash table size relative to the file size limit
+
+struct CacheFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evicted;
+    uint32_t slotsNum;   // size of the hash table (power of two)
+    uint32_t recordsNum; // number of used slots
+};
+
+// the header is followed by the hash table: offset of the record divided by 8 (0 means empty slot)
+typedef uint32_t CacheSlot;
+
+struct CacheRecordHeader
+{
+    uint64_t contentHash;
+    uint64_t paramsHash;
+    uint32_t boxesNum;
+    uint32_t checksum; // detects partially written records
+};
+
+static_assert(sizeof(GroupBox) == 4 * sizeof(int32_t), "GroupBox is stored directly in the cache file");
+static_assert(sizeof(CacheRecordHeader) % 8 == 0 && sizeof(GroupBox) % 8 == 0, "records must be 8-byte aligned");
+
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed)
+{
+    const uint64_t prime = 0x9E3779B97F4A7C15ULL;
+    const uchar* bytes = static_cast<const uchar*>(data);
+    uint64_t hash = seed ^ (static_cast<uint64_t>(size) * prime);
+
+    // process 8 bytes at once
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(word));
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 31;
+    }
+
+    for (; i < size; ++i)
+        hash = (hash ^ bytes[i]) * prime;
+
+    hash ^= hash >> 29;
+    hash *= prime;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+uint64_t HashDetectorParams(bool reducedDecode, const cv::Rect* roi)
+{
+    const double params[] =
+    {
+        DETECTOR_VERSION,
+        HISTOGRAM_CUT,
+        COLOR_TRESHOLD,
+        SEGMENT_MIN_SIZE,
+        CLASSIFY_I1_MIN, CLASSIFY_I1_MAX,
+        CLASSIFY_I2_MIN, CLASSIFY_I2_MAX,
+        CLASSIFY_I3_MIN, CLASSIFY_I3_MAX,
+        CLASSIFY_I4_MIN, CLASSIFY_I4_MAX,
+        CLASSIFY_I7_MIN, CLASSIFY_I7_MAX,
+        CLASSIFY_W9_MIN, CLASSIFY_W9_MAX,
+        GROUP_LETTERS,
+        GROUP_LETTERS_TOLERANCE,
+        GROUP_SIZE_PENALTY,
+        GROUP_HEIGHT_TOLERANCE,
+        GROUP_BASELINE_TOLERANCE,
+        GROUP_SPACING_TOLERANCE,
+        GROUP_MAX_OVERLAP,
+        GROUP_MIN_ELONGATION,
+        GROUP_MAX_PENALTY,
+        reducedDecode ? (double)REDUCED_DECODE_LETTER_RATIO : 0.0,
+        roi ? (double)roi->x : -1.0,
+        roi ? (double)roi->y : -1.0,
+        roi ? (double)roi->width : -1.0,
+        roi ? (double)roi->height : -1.0,
+    };
+
+    return HashBytes(params, sizeof(params));
+}
+
+static uint32_t RecordChecksum(const CacheRecordHeader& header, const void* boxes)
+{
+    uint64_t hash = HashBytes(boxes, header.boxesNum * sizeof(GroupBox),
+                              header.contentHash ^ header.paramsHash ^ header.boxesNum);
+    return static_cast<uint32_t>(hash);
+}
+
+static size_t RecordSize(const CacheRecordHeader& header)
+{
+    return sizeof(CacheRecordHeader) + header.boxesNum * sizeof(GroupBox);
+}
+
+static size_t RecordsOffset(uint32_t slotsNum)
+{
+    return sizeof(CacheFileHeader) + slotsNum * sizeof(CacheSlot);
+}
+
+static uint32_t SlotsNumForSize(size_t maxSize)
+{
+    uint32_t slotsNum = RESULT_CACHE_MIN_SLOTS;
+    while (slotsNum < maxSize / RESULT_CACHE_BYTES_PER_SLOT && slotsNum < 0x40000000)
+        slotsNum *= 2;
+    return slotsNum;
+}
+
+static uint32_t FirstSlot(uint64_t contentHash, uint64_t paramsHash, uint32_t slotsNum)
+{
+    return static_cast<uint32_t>((contentHash ^ (paramsHash * 0x9E3779B97F4A7C15ULL)) & (slotsNum - 1));
+}
+
+/**
+ * Read and validate header of the mapped cache file.
+ */
+static bool ReadFileHeader(const MappedFile& file, CacheFileHeader& header)
+{
+    if (file.GetData() == nullptr || file.GetSize() < sizeof(CacheFileHeader))
+        return false;
+
+    memcpy(&header, file.GetData(), sizeof(header));
+    return header.magic == RESULT_CACHE_MAGIC && header.version == RESULT_CACHE_VERSION &&
+        header.slotsNum >= RESULT_CACHE_MIN_SLOTS && (header.slotsNum & (header.slotsNum - 1)) == 0 &&
+        file.GetSize() >= RecordsOffset(header.slotsNum);
+}
+
+/**
+ * Read record of the mapped cache file (checking the file bounds and the checksum).
+ */
+static bool ReadRecord(const MappedFile& file, size_t offset, CacheRecordHeader& header)
+{
+    if (offset + sizeof(CacheRecordHeader) > file.GetSize())
+        return false;
+
+    memcpy(&header, file.GetData() + offset, sizeof(header));
+    if (offset + RecordSize(header) > file.GetSize())
+        return false;
+
+    return RecordChecksum(header, file.GetData() + offset + sizeof(header)) == header.checksum;
+}
+
+ResultCache::ResultCache()
+    : maxSize(0)
+    , savedHits(0)
+    , savedMisses(0)
+    , savedEvicted(0)
+    , hits(0)
+    , misses(0)
+    , evicted(0)
+{
+}
+
+ResultCache::~ResultCache()
+{
+    Close();
+}
+
+bool ResultCache::Open(const std::string& fileName, size_t maxSize)
+{
+    Close();
+
+    this->fileName = fileName;
+    this->maxSize = std::max<size_t>(maxSize, RESULT_CACHE_MIN_SIZE);
+    hits = misses = evicted = 0;
+
+    FileLock lock;
+    if (!lock.Lock(fileName + ".lock") || !Load())
+    {
+        Close();
+        return false;
+    }
+
+    return true;
+}
+
+void ResultCache::Close()
+{
+    mappedFile.Close();
+    if (!fileName.empty() && (hits > 0 || misses > 0 || evicted > 0))
+    {
+        FileLock lock;
+        if (lock.Lock(fileName + ".lock"))
+            SaveStats();
+    }
+
+    fileName.clear();
+}
+
+bool ResultCache::Load()
+{
+    if (!mappedFile.Open(fileName))
+    {
+        // existing file that can not be mapped must not be replaced
+        if (std::ifstream(fileName).good())
+            return false;
+    }
+    else if (mappedFile.GetSize() > 0)
+    {
+        // never overwrite a file that is not a cache (e.g. a mistyped file name)
+        CacheFileHeader fileHeader;
+        if (!ReadFileHeader(mappedFile, fileHeader))
+            return false;
+
+        savedHits = fileHeader.hits;
+        savedMisses = fileHeader.misses;
+        savedEvicted = fileHeader.evicted;
+        return true;
+    }
+
+    // create new cache file (only if it does not exist or is empty)
+    mappedFile.Close();
+    {
+        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+        CacheFileHeader fileHeader;
+        fileHeader.magic = RESULT_CACHE_MAGIC;
+        fileHeader.version = RESULT_CACHE_VERSION;
+        fileHeader.hits = 0;
+        fileHeader.misses = 0;
+        fileHeader.evicted = 0;
+        fileHeader.slotsNum = SlotsNumForSize(maxSize);
+        fileHeader.recordsNum = 0;
+
+        std::vector<CacheSlot> slots(fileHeader.slotsNum, 0);
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(CacheSlot));
+        if (!file.good())
+            return false;
+    }
+
+    savedHits = savedMisses = savedEvicted = 0;
+    return mappedFile.Open(fileName);
+}
+
+int64_t ResultCache::FindSlot(uint64_t contentHash, uint64_t paramsHash) const
+{
+    CacheFileHeader fileHeader;
+    if (!ReadFileHeader(mappedFile, fileHeader))
+        return -1;
+
+    const CacheSlot* slots = reinterpret_cast<const CacheSlot*>(mappedFile.GetData() + sizeof(CacheFileHeader));
+    const uint32_t mask = fileHeader.slotsNum - 1;
+
+    // linear probing
+    uint32_t slot = FirstSlot(contentHash, paramsHash, fileHeader.slotsNum);
+    for (uint32_t probe = 0; probe < fileHeader.slotsNum; ++probe, slot = (slot + 1) & mask)
+    {
+        if (slots[slot] == 0)
+            return slot;
+
+        CacheRecordHeader header;
+        size_t offset = static_cast<size_t>(slots[slot]) * 8;
+        if (offset + sizeof(CacheRecordHeader) <= mappedFile.GetSize())
+        {
+            memcpy(&header, mappedFile.GetData() + offset, sizeof(header));
+            if (header.contentHash == contentHash && header.paramsHash == paramsHash)
+                return slot;
+        }
+    }
+
+    return -1;
+}
+
+bool ResultCache::Compact(size_t targetSize)
+{
+    CacheFileHeader fileHeader;
+    if (!ReadFileHeader(mappedFile, fileHeader))
+        return false;
+
+    // records referenced by the hash table (outdated duplicates and partial writes are dropped)
+    const CacheSlot* slots = reinterpret_cast<const CacheSlot*>(mappedFile.GetData() + sizeof(CacheFileHeader));
+    std::vector<size_t> offsets;
+    for (uint32_t i = 0; i < fileHeader.slotsNum; ++i)
+    {
+        CacheRecordHeader header;
+        size_t offset = static_cast<size_t>(slots[i]) * 8;
+        if (slots[i] != 0 && ReadRecord(mappedFile, offset, header))
+            offsets.push_back(offset);
+    }
+
+    // records are appended, so the newest ones have the highest offsets
+    std::sort(offsets.begin(), offsets.end(), std::greater<size_t>());
+
+    // keep the newest records that fit in the target size and in half of the new table
+    const uint32_t slotsNum = SlotsNumForSize(maxSize);
+    size_t totalSize = RecordsOffset(slotsNum);
+    std::vector<size_t> keptRecords;
+    for (size_t offset : offsets)
+    {
+        CacheRecordHeader header;
+        memcpy(&header, mappedFile.GetData() + offset, sizeof(header));
+        size_t recordSize = RecordSize(header);
+        if (totalSize + recordSize > targetSize || keptRecords.size() >= slotsNum / 2)
+        {
+            evicted++;
+            continue;
+        }
+
+        totalSize += recordSize;
+        keptRecords.push_back(offset);
+    }
+
+    // rebuild the hash table for the new record offsets (the oldest records first)
+    std::vector<CacheSlot> newSlots(slotsNum, 0);
+    size_t newOffset = RecordsOffset(slotsNum);
+    for (auto it = keptRecords.rbegin(); it != keptRecords.rend(); ++it)
+    {
+        CacheRecordHeader header;
+        memcpy(&header, mappedFile.GetData() + *it, sizeof(header));
+
+        uint32_t slot = FirstSlot(header.contentHash, header.paramsHash, slotsNum);
+        while (newSlots[slot] != 0)
+            slot = (slot + 1) & (slotsNum - 1);
+        newSlots[slot] = static_cast<CacheSlot>(newOffset / 8);
+        newOffset += RecordSize(header);
+    }
+
+    // the file lock is held, so the temporary file name can not collide with other processes
+    std::string tempFileName = fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+
+        // the counters are copied from the current file
+        fileHeader.slotsNum = slotsNum;
+        fileHeader.recordsNum = static_cast<uint32_t>(keptRecords.size());
+        file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+        file.write(reinterpret_cast<const char*>(newSlots.data()), newSlots.size() * sizeof(CacheSlot));
+
+        for (auto it = keptRecords.rbegin(); it != keptRecords.rend(); ++it)
+        {
+            CacheRecordHeader header;
+            memcpy(&header, mappedFile.GetData() + *it, sizeof(header));
+            file.write(reinterpret_cast<const char*>(mappedFile.GetData() + *it), RecordSize(header));
+        }
+
+        if (!file.good())
+            return false;
+    }
+
+    // the file must be unmapped before it is replaced
+    mappedFile.Close();
+    std::remove(fileName.c_str());
+    if (std::rename(tempFileName.c_str(), fileName.c_str()) != 0)
+        return false;
+
+    return mappedFile.Open(fileName) && ReadFileHeader(mappedFile, fileHeader);
+}
+
+bool ResultCache::SaveStats()
+{
+    std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+    CacheFileHeader fileHeader;
+    file.read(reinterpret_cast<char*>(&fileHeader), sizeof(fileHeader));
+    if (!file.good() || fileHeader.magic != RESULT_CACHE_MAGIC || fileHeader.version != RESULT_CACHE_VERSION)
+        return false;
+
+    fileHeader.hits += hits;
+    fileHeader.misses += misses;
+    fileHeader.evicted += evicted;
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+    if (!file.good())
+        return false;
+
+    savedHits = fileHeader.hits;
+    savedMisses = fileHeader.misses;
+    savedEvicted = fileHeader.evicted;
+    hits = misses = evicted = 0;
+    return true;
+}
+
+bool ResultCache::Lookup(uint64_t contentHash, uint64_t paramsHash, std::vector<GroupBox>& boxes)
+{
+    // the hash table is shared with other processes, so the slot is read from the mapping
+    int64_t slot = FindSlot(contentHash, paramsHash);
+    CacheSlot value = 0;
+    if (slot >= 0)
+        value = reinterpret_cast<const CacheSlot*>(mappedFile.GetData() + sizeof(CacheFileHeader))[slot];
+
+    CacheRecordHeader header;
+    size_t offset = static_cast<size_t>(value) * 8;
+    if (value == 0 || !ReadRecord(mappedFile, offset, header) ||
+        header.contentHash != contentHash || header.paramsHash != paramsHash)
+    {
+        misses++;
+        return false;
+    }
+
+    boxes.resize(header.boxesNum);
+    if (header.boxesNum > 0)
+        memcpy(boxes.data(), mappedFile.GetData() + offset + sizeof(header), header.boxesNum * sizeof(GroupBox));
+
+    hits++;
+    return true;
+}
+
+bool ResultCache::Store(uint64_t contentHash, uint64_t paramsHash, const std::vector<GroupBox>& boxes)
+{
+    if (fileName.empty())
+        return false;
+
+    CacheRecordHeader header;
+    header.contentHash = contentHash;
+    header.paramsHash = paramsHash;
+    header.boxesNum = static_cast<uint32_t>(boxes.size());
+    header.checksum = RecordChecksum(header, boxes.data());
+    const size_t recordSize = RecordSize(header);
+
+    FileLock lock;
+    if (!lock.Lock(fileName + ".lock"))
+        return false;
+
+    // other processes may have appended to (or compacted) the file since it was mapped
+    CacheFileHeader fileHeader;
+    if (!mappedFile.Open(fileName) || !ReadFileHeader(mappedFile, fileHeader))
+        return false;
+    if (RecordsOffset(fileHeader.slotsNum) + recordSize > maxSize / 2)
+        return false;
+
+    // evict the oldest records, so the file fills up to half of the limit
+    size_t end = (mappedFile.GetSize() + 7) & ~static_cast<size_t>(7); // skip partially written record
+    if (end + recordSize > maxSize || 4 * (fileHeader.recordsNum + 1) > 3 * fileHeader.slotsNum)
+    {
+        if (!Compact(maxSize / 2))
+            return false;
+        memcpy(&fileHeader, mappedFile.GetData(), sizeof(fileHeader));
+        end = mappedFile.GetSize();
+    }
+
+    int64_t slot = FindSlot(contentHash, paramsHash);
+    if (slot < 0 || end / 8 > 0xFFFFFFFFULL)
+        return false;
+    const CacheSlot oldValue = reinterpret_cast<const CacheSlot*>(mappedFile.GetData() + sizeof(CacheFileHeader))[slot];
+
+    std::fstream file(fileName, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(end);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (!boxes.empty())
+        file.write(reinterpret_cast<const char*>(boxes.data()), boxes.size() * sizeof(GroupBox));
+    file.flush();
+    if (!file.good())
+        return false;
+
+    // the record is referenced only after it is completely written
+    CacheSlot value = static_cast<CacheSlot>(end / 8);
+    file.seekp(sizeof(CacheFileHeader) + static_cast<size_t>(slot) * sizeof(CacheSlot));
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+
+    if (oldValue == 0)
+    {
+        fileHeader.recordsNum++;
+        file.seekp(offsetof(CacheFileHeader, recordsNum));
+        file.write(reinterpret_cast<const char*>(&fileHeader.recordsNum), sizeof(fileHeader.recordsNum));
+    }
+
+    return file.good();
+}
@@ -0,0 +1,117 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#pragma once
+
+#include "Processing.hpp"
+#include "MappedFile.hpp"
+
+/**
+ * Fast (non-cryptographic) 64-bit hash of a memory block.
+ */
+uint64_t HashBytes(const void* data, size_t size, uint64_t seed = 0);
+
+/**
+ * Hash of all parameters that affect the detection results.
+ * @param reducedDecode Reduced resolution decode pass is enabled
+ * @param roi           Optional region of interest
+ */
+uint64_t HashDetectorParams(bool reducedDecode, const cv::Rect* roi);
+
+/**
+ * Persistent cache of the detection results.
+ *
+ * Results are stored in an append-only file, which is memory-mapped for lookups. Records are
+ * keyed by hash of the encoded image file content and hash of the detector parameters and
+ * found through a fixed-size hash table of record offsets stored after the file header, so
+ * opening the cache and looking a key up does not depend on the number of records.
+ * When the file grows above the size limit (or the table fills up), the oldest records are evicted.
+ *
+ * Hit, miss and eviction counters are accumulated in the file header over all runs. The file
+ * can be shared by concurrent processes: modifications are serialized with "<file>.lock".
+ */
+class ResultCache
+{
+private:
+    std::string fileName;
+    size_t maxSize;
+    MappedFile mappedFile;
+
+    // counters stored in the file header (when it was read last time)
+    uint64_t savedHits;
+    uint64_t savedMisses;
+    uint64_t savedEvicted;
+
+    // counters of this process that are not yet added to the file header
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evicted;
+
+    // these must be called with the file lock held
+    bool Load();
+    bool Compact(size_t targetSize);
+    bool SaveStats();
+
+    /**
+     * Find slot of the key in the hash table of the mapped file. Returns the first empty slot
+     * if the key is not present, or -1 if the table is full.
+     */
+    int64_t FindSlot(uint64_t contentHash, uint64_t paramsHash) const;
+
+
+    ResultCache(const ResultCache&);
+    ResultCache& operator=(const ResultCache&);
+
+public:
+    ResultCache();
+    ~ResultCache();
+
+    /**
+     * Open cache file. The file is created only if it does not exist or is empty - any other file
+     * that is not a compatible cache is left untouched and the function fails.
+     * @param maxSize File size limit in bytes
+     */
+    bool Open(const std::string& fileName, size_t maxSize);
+
+    /**
+     * Close the cache and add the counters of this process to the file header.
+     */
+    void Close();
+
+    /**
+     * Find cached detection results.
+     */
+    bool Lookup(uint64_t contentHash, uint64_t paramsHash, std::vector<GroupBox>& boxes);
+
+    /**
+     * Append detection results to the cache (evicting the oldest records if needed).
+     */
+    bool Store(uint64_t contentHash, uint64_t paramsHash, const std::vector<GroupBox>& boxes);
+
+    /**
+     * Total number of hits (all runs).
+     */
+    uint64_t GetHits() const
+    {
+        return savedHits + hits;
+    }
+
+    /**
+     * Total number of misses (all runs).
+     */
+    uint64_t GetMisses() const
+    {
+        return savedMisses + misses;
+    }
+
+    /**
+     * Total number of evicted records (all runs).
+     */
+    uint64_t GetEvicted() const
+    {
+        return savedEvicted + evicted;
+    }
+};
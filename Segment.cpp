@@ -43,14 +43,24 @@ void Segment::Process()
 bool Segment::CanReject(int imageWidth, int imageHeight) const
 {
     return
-        (maxx - minx < 7) ||
-        (maxy - miny < 7) ||
+        (maxx - minx < SEGMENT_MIN_SIZE) ||
+        (maxy - miny < SEGMENT_MIN_SIZE) ||
         (maxx - minx > imageWidth / 4) ||
         (maxy - miny > imageHeight / 4);
 }
 
 Moments Segment::CalculateMoments() const
 {
+    return CalculateMoments<MOMENT_ALL>();
+}
+
+template <unsigned Flags>
+Moments Segment::CalculateMoments() const
+{
+    // the conditions below are compile-time constants, so only the required
+    // accumulations and invariants are left in each specialization
+    const int order = MomentsTraits<Flags>::Order;
+
     /// center of AABB
     int boxCx = (maxx - minx) / 2;
     int boxCy = (maxy - miny) / 2;
@@ -64,60 +74,84 @@ Moments Segment::CalculateMoments() const
         { 0.0, 0.0, 0.0, 0.0 },
     };
 
-    for (const Pixel& p : pixels)
+    M[0][0] = static_cast<double>(pixels.size());
+    if (order >= 2)
     {
-        double x = static_cast<double>(p.x - boxCx);
-        double y = static_cast<double>(p.y - boxCy);
-
-        M[0][0] += 1.0;
-        M[1][0] += x;
-        M[0][1] += y;
-        M[1][1] += x * y;
-        M[2][0] += x * x;
-        M[0][2] += y * y;
-        M[1][2] += x * y * y;
-        M[2][1] += x * x * y;
-        M[3][0] += x * x * x;
-        M[0][3] += y * y * y;
+        for (const Pixel& p : pixels)
+        {
+            double x = static_cast<double>(p.x - boxCx);
+            double y = static_cast<double>(p.y - boxCy);
+
+            M[1][0] += x;
+            M[0][1] += y;
+            M[1][1] += x * y;
+            M[2][0] += x * x;
+            M[0][2] += y * y;
+
+            if (order >= 3)
+            {
+                M[1][2] += x * y * y;
+                M[2][1] += x * x * y;
+                M[3][0] += x * x * x;
+                M[0][3] += y * y * y;
+            }
+        }
     }
 
-    double cx = M[1][0] / M[0][0];
-    double cy = M[0][1] / M[0][0];
+    Moments moments;
+    for (int i = 0; i < 11; ++i)
+        moments.I[i] = 0.0;
 
-    /// calculate central momemnts
-    double m[4][4] =
+    if (order >= 2)
     {
-        { 0.0, 0.0, 0.0, 0.0 },
-        { 0.0, 0.0, 0.0, 0.0 },
-        { 0.0, 0.0, 0.0, 0.0 },
-        { 0.0, 0.0, 0.0, 0.0 },
-    };
+        double cx = M[1][0] / M[0][0];
+        double cy = M[0][1] / M[0][0];
 
-    m[0][0] = M[0][0];
-    m[0][1] = M[0][1] - (M[0][1] / M[0][0]) * M[0][0];
-    m[1][0] = M[1][0] - (M[1][0] / M[0][0]) * M[0][0];
-    m[1][1] = M[1][1] - (M[1][0] * M[0][1]) / M[0][0];
-    m[2][0] = M[2][0] - (M[1][0] * M[1][0]) / M[0][0];
-    m[0][2] = M[0][2] - (M[0][1] * M[0][1]) / M[0][0];
-    m[2][1] = M[2][1] - 2 * M[1][1] * cx - M[2][0] * cy + 2 * M[0][1] * cx * cx;
-    m[1][2] = M[1][2] - 2 * M[1][1] * cy - M[0][2] * cx + 2 * M[1][0] * cy * cy;
-    m[3][0] = M[3][0] - 3 * M[2][0] * cx + 2 * M[1][0] * cx * cx;
-    m[0][3] = M[0][3] - 3 * M[0][2] * cy + 2 * M[0][1] * cy * cy;
-
-
-    /// calculate scale invariant moments
-    Moments moments;
-    moments.I[0] = 0.0;
-    moments.I[1] = (m[2][0] + m[0][2]) / pow(m[0][0], 2);
-    moments.I[2] = (pow(m[2][0] - m[0][2], 2) + 4 * m[1][1] * m[1][1]) / pow(m[0][0], 4);
-    moments.I[3] = (pow(m[3][0] - 3 * m[1][2], 2) + pow(3 * m[2][1] - m[0][3], 2)) / pow(m[0][0], 5);
-    moments.I[4] = (pow(m[3][0] + m[1][2], 2) + pow(m[2][1] + m[0][3], 2)) / pow(m[0][0], 5);
-    moments.I[5] = ((m[3][0] - 3 * m[1][2]) * (m[3][0] + m[1][2]) * (pow(m[3][0] + m[1][2], 2) - 3 * pow(m[2][1] + m[0][3], 2)) + (3 * m[2][1] - m[0][3]) * (m[2][1] + m[0][3]) * (3 * pow(m[3][0] + m[1][2], 2) - pow(m[2][1] + m[0][3], 2))) / pow(m[0][0], 10);
-    moments.I[6] = ((m[2][0] - m[0][2]) * (pow(m[3][0] + m[1][2], 2) - pow(m[2][1] + m[0][3], 2)) + 4 * m[1][1] * (m[3][0] + m[1][2]) * (m[2][1] + m[0][3])) / pow(m[0][0], 7);
-    moments.I[7] = (m[2][0] * m[0][2] - m[1][1] * m[1][1]) / pow(m[0][0], 4);
-    moments.I[8] = (m[3][0] * m[1][2] + m[2][1] * m[0][3] - m[1][2] * m[1][2] - m[2][1] * m[2][1]) / pow(m[0][0], 5);
-    moments.I[9] = (m[2][0] * (m[2][1] * m[0][3] - m[1][2] * m[1][2]) + m[0][2] * (m[0][3] * m[1][2] - m[2][1] * m[2][1]) - m[1][1] * (m[3][0] * m[0][3] - m[2][1] * m[1][2])) / pow(m[0][0], 7);
-    moments.I[10] = (pow(m[3][0] * m[0][3] - m[1][2] * m[2][1], 2) - 4 * (m[3][0] * m[1][2] - m[2][1] * m[2][1]) * (m[0][3] * m[2][1] - m[1][2])) / pow(m[0][0], 10);
+        /// calculate central momemnts
+        double m[4][4] =
+        {
+            { 0.0, 0.0, 0.0, 0.0 },
+            { 0.0, 0.0, 0.0, 0.0 },
+            { 0.0, 0.0, 0.0, 0.0 },
+            { 0.0, 0.0, 0.0, 0.0 },
+        };
+
+        m[0][0] = M[0][0];
+        m[0][1] = M[0][1] - (M[0][1] / M[0][0]) * M[0][0];
+        m[1][0] = M[1][0] - (M[1][0] / M[0][0]) * M[0][0];
+        m[1][1] = M[1][1] - (M[1][0] * M[0][1]) / M[0][0];
+        m[2][0] = M[2][0] - (M[1][0] * M[1][0]) / M[0][0];
+        m[0][2] = M[0][2] - (M[0][1] * M[0][1]) / M[0][0];
+        if (order >= 3)
+        {
+            m[2][1] = M[2][1] - 2 * M[1][1] * cx - M[2][0] * cy + 2 * M[0][1] * cx * cx;
+            m[1][2] = M[1][2] - 2 * M[1][1] * cy - M[0][2] * cx + 2 * M[1][0] * cy * cy;
+            m[3][0] = M[3][0] - 3 * M[2][0] * cx + 2 * M[1][0] * cx * cx;
+            m[0][3] = M[0][3] - 3 * M[0][2] * cy + 2 * M[0][1] * cy * cy;
+        }
+
+        /// calculate scale invariant moments
+        if (Flags & MOMENT_I(1))
+            moments.I[1] = (m[2][0] + m[0][2]) / pow(m[0][0], 2);
+        if (Flags & MOMENT_I(2))
+            moments.I[2] = (pow(m[2][0] - m[0][2], 2) + 4 * m[1][1] * m[1][1]) / pow(m[0][0], 4);
+        if (Flags & MOMENT_I(3))
+            moments.I[3] = (pow(m[3][0] - 3 * m[1][2], 2) + pow(3 * m[2][1] - m[0][3], 2)) / pow(m[0][0], 5);
+        if (Flags & MOMENT_I(4))
+            moments.I[4] = (pow(m[3][0] + m[1][2], 2) + pow(m[2][1] + m[0][3], 2)) / pow(m[0][0], 5);
+        if (Flags & MOMENT_I(5))
+            moments.I[5] = ((m[3][0] - 3 * m[1][2]) * (m[3][0] + m[1][2]) * (pow(m[3][0] + m[1][2], 2) - 3 * pow(m[2][1] + m[0][3], 2)) + (3 * m[2][1] - m[0][3]) * (m[2][1] + m[0][3]) * (3 * pow(m[3][0] + m[1][2], 2) - pow(m[2][1] + m[0][3], 2))) / pow(m[0][0], 10);
+        if (Flags & MOMENT_I(6))
+            moments.I[6] = ((m[2][0] - m[0][2]) * (pow(m[3][0] + m[1][2], 2) - pow(m[2][1] + m[0][3], 2)) + 4 * m[1][1] * (m[3][0] + m[1][2]) * (m[2][1] + m[0][3])) / pow(m[0][0], 7);
+        if (Flags & MOMENT_I(7))
+            moments.I[7] = (m[2][0] * m[0][2] - m[1][1] * m[1][1]) / pow(m[0][0], 4);
+        if (Flags & MOMENT_I(8))
+            moments.I[8] = (m[3][0] * m[1][2] + m[2][1] * m[0][3] - m[1][2] * m[1][2] - m[2][1] * m[2][1]) / pow(m[0][0], 5);
+        if (Flags & MOMENT_I(9))
+            moments.I[9] = (m[2][0] * (m[2][1] * m[0][3] - m[1][2] * m[1][2]) + m[0][2] * (m[0][3] * m[1][2] - m[2][1] * m[2][1]) - m[1][1] * (m[3][0] * m[0][3] - m[2][1] * m[1][2])) / pow(m[0][0], 7);
+        if (Flags & MOMENT_I(10))
+            moments.I[10] = (pow(m[3][0] * m[0][3] - m[1][2] * m[2][1], 2) - 4 * (m[3][0] * m[1][2] - m[2][1] * m[2][1]) * (m[0][3] * m[2][1] - m[1][2])) / pow(m[0][0], 10);
+    }
 
     /*
     // from wikipedia
@@ -134,8 +168,28 @@ Moments Segment::CalculateMoments() const
     m[0][3] = M[0][3] - 3.0 * cy * M[0][2] + 2.0 * cy * cy * M[0][1];
     */
 
+    moments.S = M[0][0];
+    moments.L = 0.0;
+    moments.W9 = 0.0;
+    if (MomentsTraits<Flags>::Perimeter)
+    {
+        moments.L = static_cast<double>(CalculatePerimeter());
+        moments.W9 = 2.0 * sqrt(3.14159 * moments.S) / moments.L;
+    }
+
+    return moments;
+}
+
+// specializations used by the detector and the moments calculator
+template Moments Segment::CalculateMoments<MOMENT_ALL>() const;
+template Moments Segment::CalculateMoments<MOMENT_CLASSIFIER>() const;
+template Moments Segment::CalculateMoments<MOMENT_CLASSIFIER_INVARIANTS>() const;
+template Moments Segment::CalculateMoments<MOMENT_W9>() const;
+
+int Segment::CalculatePerimeter() const
+{
     // create image containing the segment
-    cv::Mat img(maxy-miny+1, maxx-minx+1, CV_8SC1, cvScalar(0.0f));
+    cv::Mat img(maxy-miny+1, maxx-minx+1, CV_8SC1, cv::Scalar::all(0));
     for (const Pixel& p : pixels)
         img.at<uchar>(p.y - miny, p.x - minx) = 255;
 
@@ -159,12 +213,8 @@ Moments Segment::CalculateMoments() const
             }
         }
     }
-    moments.L = static_cast<double>(L);
-    moments.S = static_cast<double>(M[0][0]);
 
-    moments.W9 = 2.0 * sqrt(3.14159 * moments.S) / moments.L;
-
-    return moments;
+    return L;
 }
 
 void Segment::FromImage(const cv::Mat& m, uchar ref)
@@ -181,36 +231,38 @@ void Segment::FromImage(const cv::Mat& m, uchar ref)
 
 int Segment::Classify() const
 {
-    Moments moments = CalculateMoments();
+    // the perimeter is the most expensive part, so W9 is checked last
+    Moments moments = CalculateMoments<MOMENT_CLASSIFIER_INVARIANTS>();
 
-    if (moments.I[1] < 0.18)
+    if (moments.I[1] < CLASSIFY_I1_MIN)
         return 0;
-    if (moments.I[1] > 0.29)
+    if (moments.I[1] > CLASSIFY_I1_MAX)
         return 0;
 
-    if (moments.I[2] < 1.0e-5)
+    if (moments.I[2] < CLASSIFY_I2_MIN)
         return 0;
-    if (moments.I[2] > 0.04)
+    if (moments.I[2] > CLASSIFY_I2_MAX)
         return 0;
 
-    if (moments.I[3] < 1.0e-10)
+    if (moments.I[3] < CLASSIFY_I3_MIN)
         return 0;
-    if (moments.I[3] > 0.006)
+    if (moments.I[3] > CLASSIFY_I3_MAX)
         return 0;
 
-    if (moments.I[4] < 1.0e-9)
+    if (moments.I[4] < CLASSIFY_I4_MIN)
         return 0;
-    if (moments.I[4] > 0.0006)
+    if (moments.I[4] > CLASSIFY_I4_MAX)
         return 0;
 
-    if (moments.I[7] < 0.008)
+    if (moments.I[7] < CLASSIFY_I7_MIN)
         return 0;
-    if (moments.I[7] > 0.018)
+    if (moments.I[7] > CLASSIFY_I7_MAX)
         return 0;
 
-    if (moments.W9 < 0.29)
+    moments.W9 = CalculateMoments<MOMENT_W9>().W9;
+    if (moments.W9 < CLASSIFY_W9_MIN)
         return 0;
-    if (moments.W9 > 0.59)
+    if (moments.W9 > CLASSIFY_W9_MAX)
         return 0;
 
     return 1;
@@ -15,6 +15,34 @@ struct Moments
     double W9;
 };
 
+/// selection of calculated moments (used as Segment::CalculateMoments template parameter)
+#define MOMENT_I(n) (1u << (n))
+#define MOMENT_W9 (1u << 11)
+#define MOMENT_ALL (MOMENT_I(1) | MOMENT_I(2) | MOMENT_I(3) | MOMENT_I(4) | MOMENT_I(5) | \
+                    MOMENT_I(6) | MOMENT_I(7) | MOMENT_I(8) | MOMENT_I(9) | MOMENT_I(10) | MOMENT_W9)
+#define MOMENT_CLASSIFIER_INVARIANTS (MOMENT_I(1) | MOMENT_I(2) | MOMENT_I(3) | MOMENT_I(4) | MOMENT_I(7))
+#define MOMENT_CLASSIFIER (MOMENT_CLASSIFIER_INVARIANTS | MOMENT_W9)
+
+// invariants that require only the second order moments
+#define MOMENT_SECOND_ORDER (MOMENT_I(1) | MOMENT_I(2) | MOMENT_I(7))
+
+/**
+ * Compile-time properties of the selected moments set.
+ */
+template <unsigned Flags>
+struct MomentsTraits
+{
+    enum
+    {
+        // maximum order of the accumulated raw moments
+        Order = (Flags & MOMENT_ALL & ~MOMENT_W9 & ~MOMENT_SECOND_ORDER) ? 3 :
+                (Flags & MOMENT_SECOND_ORDER) ? 2 : 0,
+
+        // perimeter (and W9 coefficient) is needed
+        Perimeter = (Flags & MOMENT_W9) ? 1 : 0,
+    };
+};
+
 struct Pixel
 {
     int x;
@@ -37,6 +65,23 @@ struct Letters
     double letters[LETTER_NUM];
 };
 
+// minimum size of segment bounding box (smaller segments are rejected)
+#define SEGMENT_MIN_SIZE 7
+
+/// classifier thresholds (accepted ranges of the invariant moments)
+#define CLASSIFY_I1_MIN 0.18
+#define CLASSIFY_I1_MAX 0.29
+#define CLASSIFY_I2_MIN 1.0e-5
+#define CLASSIFY_I2_MAX 0.04
+#define CLASSIFY_I3_MIN 1.0e-10
+#define CLASSIFY_I3_MAX 0.006
+#define CLASSIFY_I4_MIN 1.0e-9
+#define CLASSIFY_I4_MAX 0.0006
+#define CLASSIFY_I7_MIN 0.008
+#define CLASSIFY_I7_MAX 0.018
+#define CLASSIFY_W9_MIN 0.29
+#define CLASSIFY_W9_MAX 0.59
+
 class Segment
 {
 private:
@@ -71,6 +116,18 @@ public:
      */
     Moments CalculateMoments() const;
 
+    /**
+     * Calculate selected invariant moments only (see MOMENT_* flags).
+     * Moments that are not selected are set to zero.
+     */
+    template <unsigned Flags>
+    Moments CalculateMoments() const;
+
+    /**
+     * Calculate segment circumference (in pixels)
+     */
+    int CalculatePerimeter() const;
+
     int Classify() const;
 };
 
@@ -0,0 +1,201 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#include "stdafx.h"
+#include "ThreadPool.hpp"
+
+inline uint64_t PackRange(uint64_t begin, uint64_t end)
+{
+    return (end << 32) | begin;
+}
+
+inline void UnpackRange(uint64_t range, size_t& begin, size_t& end)
+{
+    begin = static_cast<size_t>(range & 0xFFFFFFFFULL);
+    end = static_cast<size_t>(range >> 32);
+}
+
+ThreadPool::ThreadPool(unsigned threadsNum)
+    : threadsNum(threadsNum)
+    , task(nullptr)
+    , generation(0)
+    , activeWorkers(0)
+    , exiting(false)
+    , failed(false)
+{
+    if (this->threadsNum == 0)
+        this->threadsNum = std::max(1u, std::thread::hardware_concurrency());
+
+    ranges.reset(new std::atomic<uint64_t>[this->threadsNum]);
+    for (unsigned i = 0; i < this->threadsNum; ++i)
+        ranges[i] = 0;
+
+    // the calling thread works as thread #0
+    for (unsigned i = 1; i < this->threadsNum; ++i)
+        threads.push_back(std::thread(&ThreadPool::WorkerMain, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        exiting = true;
+    }
+    startCondition.notify_all();
+
+    for (std::thread& thread : threads)
+        thread.join();
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::Run(size_t tasksNum, const std::function<void(size_t)>& task)
+{
+    assert(tasksNum < 0xFFFFFFFFULL);
+
+    if (tasksNum == 0)
+        return;
+
+    if (threadsNum == 1 || tasksNum == 1)
+    {
+        for (size_t i = 0; i < tasksNum; ++i)
+            task(i);
+        return;
+    }
+
+    std::unique_lock<std::mutex> runLock(runMutex);
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // deal tasks out round-robin, so each thread starts with the lowest indices
+        order.resize(tasksNum);
+        size_t position = 0;
+        for (unsigned i = 0; i < threadsNum; ++i)
+        {
+            uint64_t begin = position;
+            for (size_t index = i; index < tasksNum; index += threadsNum)
+                order[position++] = index;
+            ranges[i] = PackRange(begin, position);
+        }
+
+        this->task = &task;
+        failed = false;
+        exception = std::exception_ptr();
+        activeWorkers = threadsNum - 1;
+        generation++;
+    }
+    startCondition.notify_all();
+
+    ProcessTasks(0);
+
+    std::exception_ptr taskException;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        doneCondition.wait(lock, [this]() { return activeWorkers == 0; });
+        this->task = nullptr;
+        std::swap(taskException, exception);
+    }
+
+    if (taskException)
+        std::rethrow_exception(taskException);
+}
+
+void ThreadPool::WorkerMain(unsigned id)
+{
+    unsigned lastGeneration = 0;
+
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            startCondition.wait(lock, [&]() { return exiting || generation != lastGeneration; });
+            if (exiting)
+                return;
+            lastGeneration = generation;
+        }
+
+        ProcessTasks(id);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        doneCondition.notify_one();
+    }
+}
+
+void ThreadPool::ProcessTasks(unsigned id)
+{
+    size_t position;
+    while (!failed)
+    {
+        if (PopTask(id, position))
+        {
+            try
+            {
+                (*task)(order[position]);
+            }
+            catch (...)
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (!exception)
+                    exception = std::current_exception();
+                failed = true;
+            }
+        }
+        else if (!StealTasks(id))
+            break;
+    }
+}
+
+bool ThreadPool::PopTask(unsigned id, size_t& position)
+{
+    uint64_t range = ranges[id].load();
+    for (;;)
+    {
+        size_t begin, end;
+        UnpackRange(range, begin, end);
+        if (begin >= end)
+            return false;
+
+        if (ranges[id].compare_exchange_weak(range, PackRange(begin + 1, end)))
+        {
+            position = begin;
+            return true;
+        }
+    }
+}
+
+bool ThreadPool::StealTasks(unsigned id)
+{
+    for (unsigned i = 1; i < threadsNum; ++i)
+    {
+        unsigned victim = (id + i) % threadsNum;
+        uint64_t range = ranges[victim].load();
+        for (;;)
+        {
+            size_t begin, end;
+            UnpackRange(range, begin, end);
+            if (begin >= end)
+                break;
+
+            // take the back half of the victim's range (the victim works on the front)
+            size_t stolen = (end - begin + 1) / 2;
+            if (ranges[victim].compare_exchange_weak(range, PackRange(begin, end - stolen)))
+            {
+                ranges[id] = PackRange(end - stolen, end);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
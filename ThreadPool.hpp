@@ -0,0 +1,69 @@
+/**
+ * POBR - projekt
+ * 
+ * @author Michal Witanowski
+ */
+
+#pragma once
+
+/**
+ * Pool of worker threads executing a batch of indexed tasks.
+ *
+ * Tasks are dealt out to the threads round-robin (thread i gets tasks i, i + N, i + 2N...).
+ * Each thread owns a contiguous range of its tasks and takes them from the front, so lower
+ * indices are started first. A thread that runs out of work steals the back half of another
+ * thread's range, so tasks of very different cost are balanced dynamically.
+ */
+class ThreadPool
+{
+private:
+    std::vector<std::thread> threads;
+    std::unique_ptr<std::atomic<uint64_t>[]> ranges; // packed [begin, end) range of each thread
+    std::vector<size_t> order;                       // task index at each range position
+    unsigned threadsNum;
+
+    std::mutex runMutex; // serializes Run() calls
+    std::mutex mutex;
+    std::condition_variable startCondition;
+    std::condition_variable doneCondition;
+    const std::function<void(size_t)>* task;
+    unsigned generation;
+    unsigned activeWorkers;
+    bool exiting;
+
+    std::atomic<bool> failed;     // a task has thrown, remaining tasks are skipped
+    std::exception_ptr exception; // the first exception thrown by a task
+
+    void WorkerMain(unsigned id);
+    void ProcessTasks(unsigned id);
+    bool PopTask(unsigned id, size_t& position);
+    bool StealTasks(unsigned id);
+
+    ThreadPool(const ThreadPool&);
+    ThreadPool& operator=(const ThreadPool&);
+
+public:
+    /**
+     * @param threadsNum Number of threads (including the calling thread), 0 means number of CPU cores.
+     */
+    explicit ThreadPool(unsigned threadsNum = 0);
+    ~ThreadPool();
+
+    unsigned GetThreadsNum() const
+    {
+        return threadsNum;
+    }
+
+    /**
+     * Execute task(i) for each i in [0, tasksNum). The calling thread takes part in the work.
+     * The function returns when all the tasks are finished. Lower indices are started first.
+     * If a task throws, the tasks not started yet are skipped and the first exception is
+     * rethrown after all the threads have stopped.
+     */
+    void Run(size_t tasksNum, const std::function<void(size_t)>& task);
+
+    /**
+     * Pool shared by the processing stages.
+     */
+    static ThreadPool& GetDefault();
+};
@@ -5,302 +5,263 @@
  */
 
 #include "stdafx.h"
-#include "Segment.hpp"
-#include "Groupping.hpp"
+#include "Processing.hpp"
+#include "ResultCache.hpp"
+#include "FeatureFile.hpp"
 
-#define HISTOGRAM_CUT 15
-#define COLOR_TRESHOLD 0.5f
-
-/**
- * This function preprocesses input image. The following steps are prformed:
- * 1. Conversion to grayscale and histogram calculation.
- * 2. Histogram scaling (removing brightest and darkest pixels).
- * 3. Applying threshold and generating binary image (8UC1 format).
- */
-cv::Mat Preprocess(const cv::Mat& m, float treshold = 0.5f)
+int MomentCalculator(int argc, char** argv)
 {
-    assert(3 == m.channels());
-    assert(CV_8UC3 == m.type());
-
-    int histogram[256] = { 0 };
+    cv::Mat image, binaryImage;
+    FeatureWriter featureWriter;
+    bool writeFeatures = false;
 
-    // convert to grayscale and calculate histogram
-    cv::Mat grayscale(m.rows, m.cols, CV_32F); // temporary image
-    for (int i = 0; i < m.rows; ++i)
+    for (int i = 2; i < argc; ++i)
     {
-        for (int j = 0; j < m.cols; ++j)
-        {
-            cv::Vec3b color = m.at<cv::Vec3b>(i, j);
-
-            float fValue = 0.299f * (float)color[2] + 0.587f * (float)color[1] + 0.114f * (float)color[0];
-            if (fValue > 255.0f)
-                fValue = 255.0f;
-            unsigned char value = (char)(fValue);
-            histogram[value]++;
+        const char* name = argv[i];
 
-            grayscale.at<float>(i, j) = fValue / 255.0f;
+        // features are written to binary file instead of the standard output
+        if (strcmp(name, "--features") == 0 && i + 1 < argc)
+        {
+            writeFeatures = featureWriter.Open(argv[++i]);
+            if (!writeFeatures)
+            {
+                std::cerr << "Could not open the features file" << std::endl;
+                return 1;
+            }
+            continue;
         }
-    }
 
-    const int totalPixels = m.rows * m.cols;
-    int counter;
-    int lowScale = 0;
-    int highScale = 255;
+        image = cv::imread(argv[i], cv::IMREAD_COLOR);
+        if (image.empty())
+            continue;
 
-    // reject darkest pixels
-    counter = 0;
-    for (int i = 0; i < 256; ++i)
-    {
-        counter += histogram[i];
-        if (counter < totalPixels / HISTOGRAM_CUT)
-            lowScale = i;
-    }
+        binaryImage = Preprocess(image, COLOR_TRESHOLD);
 
-    // reject brightest pixels
-    counter = 0;
-    for (int i = 255; i >= 0; --i)
-    {
-        counter += histogram[i];
-        if (counter < totalPixels / HISTOGRAM_CUT)
-            highScale = i;
-    }
+        Segment seg;
+        seg.FromImage(binaryImage, 0);
+        seg.Process();
 
-    // generate final binary image 
-    cv::Mat result(m.rows, m.cols, CV_8UC1);
-    for (int i = 0; i < m.rows; ++i)
-    {
-        for (int j = 0; j < m.cols; ++j)
+        Moments moments = seg.CalculateMoments();
+        if (writeFeatures)
         {
-            float value = grayscale.at<float>(i, j);
-            value -= (float)lowScale / 256.0f;
-            value /= (float)(highScale - lowScale) / 256.0f;
-            result.at<uchar>(i, j) = value > treshold ? 255 : 0;
+            int imageId = featureWriter.AddImage(name);
+            if (imageId < 0)
+            {
+                std::cerr << "Could not write the features file" << std::endl;
+                return 1;
+            }
+            featureWriter.Write(SegmentFeatures(imageId, seg, moments, seg.Classify()));
         }
+        else
+            std::cout << moments << std::endl;
     }
 
-    return result;
-}
-
-/**
-* Simple sharpening filter
-*/
-cv::Mat Sharpen(const cv::Mat& m)
-{
-    const float filter[3][3] =
+    if (!featureWriter.Close())
     {
-        { -1.0f, -2.0f, -1.0f },
-        { -2.0f, 16.0f, -2.0f },
-        { -1.0f, -2.0f, -1.0f },
-    };
-
-    cv::Mat output(m.rows, m.cols, CV_8UC3);
-    for (int i = 0; i < m.rows; ++i)
-    {
-        for (int j = 0; j < m.cols; ++j)
-        {
-            float sumR = 0.0f, sumG = 0.0f, sumB = 0.0f;
-            for (int k = 0; k < 3; ++k)
-                for (int l = 0; l < 3; ++l)
-                {
-                    int y = std::max(0, std::min(m.rows - 1, i + k - 1));
-                    int x = std::max(0, std::min(m.cols - 1, j + l - 1));
-                    cv::Vec3b color = m.at<cv::Vec3b>(y, x);
-                    sumR += filter[k][l] * (float)color[2];
-                    sumG += filter[k][l] * (float)color[1];
-                    sumB += filter[k][l] * (float)color[0];
-                }
-
-            sumR = std::min(255.0f, std::max(0.0f, sumR / 4.0f));
-            sumG = std::min(255.0f, std::max(0.0f, sumG / 4.0f));
-            sumB = std::min(255.0f, std::max(0.0f, sumB / 4.0f));
-
-            output.at<cv::Vec3b>(i, j) = cv::Vec3b((uchar)sumB, (uchar)sumG, (uchar)sumR);
-        }
+        std::cerr << "Could not write the features file" << std::endl;
+        return 1;
     }
 
-    return output;
+    return 0;
 }
 
-/**
- * 
- */
-cv::Mat CalculatePixelGroups(const cv::Mat& input, std::vector<Segment*>& outputSegments)
+struct Options
 {
-    assert(CV_8UC1 == input.type());
-
-    std::map<int, int> labelAliasMap;
-
-    cv::Mat groupMap(input.rows, input.cols, CV_32SC1);
-    int id = 0;
-
-    for (int i = 0; i < input.rows; ++i)
+    std::string inputFile;
+    std::string outputFile; // annotated image
+    std::string cacheFile;  // persistent result cache
+    std::string featuresFile; // binary output of per-segment features
+    size_t cacheSize;       // result cache size limit (in bytes)
+    bool show;              // show the result in a window
+    bool debug;             // show intermediate images
+    bool json;              // print detected groups as JSON
+    bool reducedDecode;     // first detection pass on reduced resolution image
+    bool hasRoi;
+    cv::Rect roi;           // processed region of the image
+
+    Options()
+        : cacheSize(64 * 1024 * 1024)
+        , show(false)
+        , debug(false)
+        , json(false)
+        , reducedDecode(false)
+        , hasRoi(false)
     {
-        for (int j = 0; j < input.cols; ++j)
-        {
-            uchar currVal = input.at<uchar>(i, j);
-            bool sameAsLeft = false;
-            bool sameAsTop = false;
-
-            if (i > 0)
-                sameAsTop = (currVal == input.at<uchar>(i - 1, j));
-
-            if (j > 0)
-                sameAsLeft = (currVal == input.at<uchar>(i, j - 1));
-
-            if (sameAsTop && sameAsLeft)
-            {
-                int topLabel = labelAliasMap[groupMap.at<int>(i - 1, j)];
-                int leftLabel = labelAliasMap[groupMap.at<int>(i, j - 1)];
-                if (topLabel != leftLabel)
-                {
-                    int minLabel = std::min(topLabel, leftLabel);
-                    int maxLabel = std::max(topLabel, leftLabel);
-                    groupMap.at<int>(i, j) = minLabel;
-                    labelAliasMap[maxLabel] = minLabel;
-                    continue;
-                }
-            }
-
-            if (sameAsTop)
-            {
-                groupMap.at<int>(i, j) = labelAliasMap[groupMap.at<int>(i - 1, j)];
-            }
-            else if (sameAsLeft)
-            {
-                groupMap.at<int>(i, j) = labelAliasMap[groupMap.at<int>(i, j - 1)];
-            }
-            else // create unique label
-            {
-                int label = id++;
-                groupMap.at<int>(i, j) = label;
-                labelAliasMap[label] = label;
-            }
-        }
     }
+};
 
-    // create segments for each unique (merged) label
-    std::map<int, Segment*> segments;
-    for (auto label : labelAliasMap)
+bool ParseOptions(int argc, char** argv, Options& options)
+{
+    for (int i = 1; i < argc; ++i)
     {
-        auto it = segments.find(label.second);
-        if (it == segments.end())
+        std::string arg = argv[i];
+
+        if (arg == "--show")
+            options.show = true;
+        else if (arg == "--debug")
+            options.debug = true;
+        else if (arg == "--json")
+            options.json = true;
+        else if (arg == "--fast")
+            options.reducedDecode = true;
+        else if (arg == "--output" && i + 1 < argc)
+            options.outputFile = argv[++i];
+        else if (arg == "--cache" && i + 1 < argc)
+            options.cacheFile = argv[++i];
+        else if (arg == "--features" && i + 1 < argc)
+            options.featuresFile = argv[++i];
+        else if (arg == "--cache-size" && i + 1 < argc)
+            options.cacheSize = (size_t)std::max(1, atoi(argv[++i])) * 1024 * 1024;
+        else if (arg == "--roi" && i + 1 < argc)
         {
-            segments[label.second] = new Segment;
+            cv::Rect& roi = options.roi;
+            std::istringstream stream(argv[++i]);
+            char sep[3];
+            stream >> roi.x >> sep[0] >> roi.y >> sep[1] >> roi.width >> sep[2] >> roi.height;
+            if (stream.fail() || sep[0] != ',' || sep[1] != ',' || sep[2] != ',')
+                return false;
+            options.hasRoi = true;
         }
+        else if (arg[0] != '-' && options.inputFile.empty())
+            options.inputFile = arg;
+        else
+            return false;
     }
 
-    // fill segments with pixels
-    cv::Mat groupMapMerged(input.rows, input.cols, CV_32SC1);
-    for (int i = 0; i < input.rows; ++i)
+#ifdef POBR_HEADLESS
+    if (options.show || options.debug)
     {
-        for (int j = 0; j < input.cols; ++j)
-        {
-            int label = groupMap.at<int>(i, j);
-            int finalLabel = labelAliasMap[label];
-            groupMapMerged.at<int>(i, j) = finalLabel;
-            segments[finalLabel]->pixels.push_back(Pixel(j, i));
-        }
+        std::cerr << "Windows are not available in the headless build" << std::endl;
+        return false;
     }
+#endif // POBR_HEADLESS
 
-    std::cout << "Initial pixel groups: " << segments.size() << std::endl;
-
-    // reject invalid segments (too small, too big)
-    int rejected = 0;
-    outputSegments.clear();
-    for (auto it : segments)
-    {
-        Segment* segment = it.second;
-        segment->Process();
-        if (segment->CanReject(input.cols, input.rows))
-        {
-            rejected++;
-            delete segment;
-            continue;
-        }
-
-        outputSegments.push_back(segment);
-    }
-
-    std::cout << "Rejected pixel groups: " << rejected << std::endl;
-    return groupMapMerged;
+    return !options.inputFile.empty();
 }
 
-inline int FastRand(int x)
+void ShowImage(const std::string& title, const std::string& fileName, const cv::Mat& image)
 {
-    x = ((x >> 16) ^ x) * 0x45d9f3b;
-    x = ((x >> 16) ^ x) * 0x45d9f3b;
-    x = ((x >> 16) ^ x);
-    return x;
+#ifndef POBR_HEADLESS
+    std::string windowName = "POBR - " + title + " (" + fileName + ')';
+    cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
+    cv::imshow(windowName, image);
+#else
+    (void)title;
+    (void)fileName;
+    (void)image;
+#endif // POBR_HEADLESS
 }
 
-cv::Mat VisualizeSegments(const cv::Mat& input, const std::vector<Segment*> segments)
+std::string JsonEscape(const std::string& str)
 {
-    assert(CV_32SC1 == input.type());
-
-    cv::Mat visual(input.rows, input.cols, CV_8UC3, cvScalar(0.0f));
-
-    int id = 0;
-    for (const Segment* segment : segments)
+    std::string result;
+    for (char c : str)
     {
-        int r = FastRand(id);
-        int g = FastRand(id + 171050183);
-        int b = FastRand(id + 101531671);
-        for (const Pixel& p : segment->pixels)
+        if (c == '"' || c == '\\')
+        {
+            result += '\\';
+            result += c;
+        }
+        else if (c == '\n')
+            result += "\\n";
+        else if (c == '\r')
+            result += "\\r";
+        else if (c == '\t')
+            result += "\\t";
+        else if ((unsigned char)c < 0x20)
         {
-            visual.at<cv::Vec3b>(p.y, p.x) = cv::Vec3b(r % 192, g % 192, b % 192);
+            // other control characters are not allowed in JSON strings
+            std::ostringstream code;
+            code << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)(unsigned char)c;
+            result += code.str();
         }
-        id++;
+        else
+            result += c;
     }
-
-    return visual;
+    return result;
 }
 
-cv::Mat VisualizePixelGroups(const cv::Mat& input)
+void PrintJson(const std::string& fileName, const std::vector<GroupBox>& boxes)
 {
-    assert(CV_32SC1 == input.type());
-
-    cv::Mat visual(input.rows, input.cols, CV_8UC3, cvScalar(0.0f));
-    for (int i = 0; i < input.rows; ++i)
+    std::cout << "{\"image\": \"" << JsonEscape(fileName) << "\", \"groups\": [";
+    for (size_t i = 0; i < boxes.size(); ++i)
     {
-        for (int j = 0; j < input.cols; ++j)
-        {
-            int groupId = input.at<int>(i, j);
-            int r = FastRand(groupId);
-            int g = FastRand(groupId + 171050183);
-            int b = FastRand(groupId + 101531671);
-            visual.at<cv::Vec3b>(i, j) = cv::Vec3b(r % 256, g % 256, b % 256);
-        }
+        const GroupBox& box = boxes[i];
+        std::cout << (i > 0 ? ", " : "") <<
+            "{\"minx\": " << box.minx << ", \"miny\": " << box.miny <<
+            ", \"maxx\": " << box.maxx << ", \"maxy\": " << box.maxy << '}';
     }
-
-    return visual;
+    std::cout << "]}" << std::endl;
 }
 
-int MomentCalculator(int argc, char** argv)
+/**
+ * Run the detection stage by stage (showing the intermediate images in debug mode).
+ */
+void RunDetection(const Options& options, const cv::Mat& original, const cv::Rect& roi,
+                  std::vector<GroupBox>& validGroups, FeatureWriter* featureWriter)
 {
-    cv::Mat image, binaryImage;
+    /// preprocess input image (only the region of interest, without copying it)
+    cv::Mat image = Sharpen(original(roi));
+    cv::Mat binaryImage = Preprocess(image, COLOR_TRESHOLD);
+    if (options.debug)
+        ShowImage("binary image", options.inputFile, binaryImage);
 
-    for (int i = 2; i < argc; ++i)
-    {
-        const char* name = argv[i];
+    /// extract pixel groups and segments from binary image
+    std::vector<Segment*> segments;
+    cv::Mat pixelGroups;
+    CalculatePixelGroups(binaryImage, segments, options.debug ? &pixelGroups : nullptr, original.size());
 
-        image = cv::imread(argv[i], cv::IMREAD_COLOR);
-        if (image.empty())
-            continue;
+    /// (optional) visualize pixel groups
+    if (options.debug)
+        ShowImage("pixel groups", options.inputFile, VisualizePixelGroups(pixelGroups));
 
-        binaryImage = Preprocess(image, COLOR_TRESHOLD);
+    /// find letter candidates
+    std::vector<Segment*> letterCandidates;
+    std::vector<char> classification;
+    FindLetterCandidates(segments, letterCandidates, &classification);
 
-        Segment seg;
-        seg.FromImage(binaryImage, 0);
-        seg.Process();
+    /// (optional) write features of all segments
+    if (featureWriter != nullptr)
+    {
+        // write errors are reported when the file is closed
+        int imageId = featureWriter->AddImage(options.inputFile);
+        for (size_t i = 0; imageId >= 0 && i < segments.size(); ++i)
+        {
+            const Segment* seg = segments[i];
+            SegmentFeatures features(imageId, *seg, seg->CalculateMoments(), classification[i]);
+            features.minx += roi.x;
+            features.maxx += roi.x;
+            features.miny += roi.y;
+            features.maxy += roi.y;
+            featureWriter->Write(features);
+        }
+    }
 
-        Moments moments = seg.CalculateMoments();
-        std::cout << moments << std::endl;
+    /// (optional) visualize segments
+    if (options.debug)
+    {
+        cv::Mat segmentsVisual = VisualizeSegments(binaryImage.size(), segments);
+        for (const Segment* seg : letterCandidates)
+        {
+            cv::Scalar color = cv::Scalar(255.0, 255.0, 255.0);
+            cv::Rect rect = cv::Rect(seg->minx - 1, seg->miny - 1,
+                                     seg->maxx - seg->minx + 2, seg->maxy - seg->miny + 2);
+            cv::rectangle(segmentsVisual, rect, color, 2);
+        }
+        ShowImage("segments", options.inputFile, segmentsVisual);
     }
 
-    return 0;
-}
 
-#define DEBUG_IMAGES
+    /// group letter candidates
+    std::vector<SegmentGroup> groups;
+    PerformSegmentGroupping(letterCandidates, groups);
+    if (gVerbose)
+        std::cout << "Groups found: " << groups.size() << std::endl;
+
+    FindValidGroups(groups, validGroups);
+    TranslateGroups(validGroups, roi.x, roi.y);
+    FreeSegments(segments);
+}
 
 int main(int argc, char** argv)
 {
@@ -317,98 +278,160 @@ int main(int argc, char** argv)
         return MomentCalculator(argc, argv);
     }
 
-    std::string windowName;
-
-    /// open input image
-    cv::Mat original;
-    original = cv::imread(argv[1], cv::IMREAD_COLOR);
-    if (original.empty())
+    Options options;
+    if (!ParseOptions(argc, argv, options))
     {
-        std::cout << "Could not open or find the image" << std::endl;
-        return 1;
+        std::cout << "Usage: " << argv[0] << " [--show] [--debug] [--json] [--fast] [--output <file>] [--roi x,y,w,h]" <<
+            " [--cache <file>] [--cache-size <MB>] [--features <file>] <image>" << std::endl;
+        std::cout << "       " << argv[0] << " --moments [--features <file>] <images...>" << std::endl;
+        return -1;
     }
 
-    /// preprocess input image
-    cv::Mat image = Sharpen(original);
-    cv::Mat binaryImage = Preprocess(image, COLOR_TRESHOLD);
-#ifdef DEBUG_IMAGES
-    windowName = "POBR - binary image (" + std::string(argv[1]) + ')';
-    cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
-    cv::imshow(windowName, binaryImage);
-#endif // DEBUG_IMAGES
-
+    // JSON output must not be mixed with the statistics (errors are written to stderr)
+    gVerbose = !options.json;
 
-    /// extract pixel groups and segments from binary image
-    std::vector<Segment*> segments;
-    cv::Mat pixelGroups = CalculatePixelGroups(binaryImage, segments);
+    std::vector<GroupBox> validGroups;
+    const cv::Rect* roiPtr = options.hasRoi ? &options.roi : nullptr;
+    cv::Mat original;
 
-    /// (optional) visualize pixel groups
-#ifdef DEBUG_IMAGES
-    cv::Mat pixelGroupsImage = VisualizePixelGroups(pixelGroups);
-    windowName = "POBR - pixel groups (" + std::string(argv[1]) + ')';
-    cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
-    cv::imshow(windowName, pixelGroupsImage);
-#endif // DEBUG_IMAGES
+    /// the result cache is keyed by the encoded file content
+    std::vector<uchar> content;
+    ResultCache cache;
+    uint64_t contentHash = 0;
+    uint64_t paramsHash = 0;
+    bool useCache = !options.cacheFile.empty() && !options.debug && options.featuresFile.empty();
+    bool cached = false;
 
-    cv::Mat segmentsVisual = VisualizeSegments(pixelGroups, segments);
+    if (useCache || options.reducedDecode)
+    {
+        if (!ReadFileContent(options.inputFile, content))
+        {
+            std::cerr << "Could not open or find the image" << std::endl;
+            return 1;
+        }
+    }
 
-    /// find letter candidates
-    std::vector<Segment*> letterCandidates;
-    for (Segment* seg : segments)
-        if (seg->Classify() > 0)
+    if (useCache)
+    {
+        if (cache.Open(options.cacheFile, options.cacheSize))
+        {
+            contentHash = HashBytes(content.data(), content.size());
+            paramsHash = HashDetectorParams(options.reducedDecode, roiPtr);
+            cached = cache.Lookup(contentHash, paramsHash, validGroups);
+        }
+        else
         {
-            letterCandidates.push_back(seg);
+            std::cerr << "Could not open the result cache (existing files of other format are not overwritten): " <<
+                options.cacheFile << std::endl;
+            useCache = false;
+        }
+    }
 
-#ifdef DEBUG_IMAGES
-            cv::Scalar color = cv::Scalar(255.0, 255.0, 255.0);
-            cv::Rect rect = cv::Rect(seg->minx - 1, seg->miny - 1,
-                                     seg->maxx - seg->minx + 2, seg->maxy - seg->miny + 2);
-            cv::rectangle(segmentsVisual, rect, color, 2);
-#endif // DEBUG_IMAGES
+    // cached results are returned without decoding the image
+    if (!cached)
+    {
+        if (options.reducedDecode && !options.debug && options.featuresFile.empty())
+        {
+            /// detect on encoded file content (decoded at reduced resolution first)
+            if (!DetectGroupsInEncoded(content.data(), content.size(), roiPtr, validGroups, true))
+            {
+                std::cerr << "Could not decode the image or region of interest is outside of the image" << std::endl;
+                return 1;
+            }
         }
+        else
+        {
+            /// open input image
+            if (content.empty())
+                original = cv::imread(options.inputFile, cv::IMREAD_COLOR);
+            else
+                original = cv::imdecode(cv::Mat(content), cv::IMREAD_COLOR);
 
-    /// (optional) visualize segments
-#ifdef DEBUG_IMAGES
-    windowName = "POBR - segments (" + std::string(argv[1]) + ')';
-    cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
-    cv::imshow(windowName, segmentsVisual);
-#endif // DEBUG_IMAGES
+            if (original.empty())
+            {
+                std::cerr << "Could not open or find the image" << std::endl;
+                return 1;
+            }
 
+            cv::Rect roi;
+            if (!ClipRoi(original.size(), roiPtr, roi))
+            {
+                std::cerr << "Region of interest is outside of the image" << std::endl;
+                return 1;
+            }
 
-    /// group letter candidates
-    std::vector<SegmentGroup> groups;
-    PerformSegmentGroupping(letterCandidates, groups);
-    std::cout << "Groups found: " << groups.size() << std::endl;
+            FeatureWriter featureWriter;
+            if (!options.featuresFile.empty() && !featureWriter.Open(options.featuresFile))
+            {
+                std::cerr << "Could not open the features file" << std::endl;
+                return 1;
+            }
 
-    int validGroups = 0;
-    for (const auto& group : groups)
-    {
-        if (group.size() == 7)
-        {
-            int minx = 1000000, miny = 1000000, maxx = 0, maxy = 0;
-            for (const Segment* seg : group)
+            RunDetection(options, original, roi, validGroups,
+                         options.featuresFile.empty() ? nullptr : &featureWriter);
+
+            // a failed write leaves a truncated file, which must not be reported as success
+            if (!featureWriter.Close())
             {
-                minx = std::min(minx, seg->minx);
-                maxx = std::max(maxx, seg->maxx);
-                miny = std::min(miny, seg->miny);
-                maxy = std::max(maxy, seg->maxy);
+                std::cerr << "Could not write the features file" << std::endl;
+                return 1;
             }
+        }
+    }
 
-            std::cout << "Group #" << validGroups++ <<
-                "  minX=" << minx << ", minY=" << miny <<
-                ", maxX=" << maxx << ", maxY=" << maxy << std::endl;
+    if (useCache)
+    {
+        if (!cached)
+            cache.Store(contentHash, paramsHash, validGroups);
+
+        // the counters of this run are added to the totals stored in the cache file
+        cache.Close();
+        if (gVerbose)
+            std::cout << "Result cache " << (cached ? "hit" : "miss") << ", all runs: hits = " << cache.GetHits() <<
+                ", misses = " << cache.GetMisses() << ", evicted = " << cache.GetEvicted() << std::endl;
+    }
 
-            // draw valid group
+    if (options.json)
+        PrintJson(options.inputFile, validGroups);
+    else
+    {
+        for (size_t i = 0; i < validGroups.size(); ++i)
+        {
+            const GroupBox& box = validGroups[i];
+            std::cout << "Group #" << i <<
+                "  minX=" << box.minx << ", minY=" << box.miny <<
+                ", maxX=" << box.maxx << ", maxY=" << box.maxy << std::endl;
+        }
+    }
+
+    /// (optional) draw valid groups on the original image
+    if (options.show || !options.outputFile.empty())
+    {
+        if (original.empty())
+            original = cv::imread(options.inputFile, cv::IMREAD_COLOR);
+
+        for (const GroupBox& box : validGroups)
+        {
             cv::Scalar color = cv::Scalar(0.0, 0.0, 255.0);
-            cv::Rect rect = cv::Rect(minx - 1, miny - 1, maxx - minx + 2, maxy - miny + 2);
+            cv::Rect rect = cv::Rect(box.minx - 1, box.miny - 1,
+                                     box.maxx - box.minx + 2, box.maxy - box.miny + 2);
             cv::rectangle(original, rect, color, 2);
         }
+
+        if (!options.outputFile.empty() && !cv::imwrite(options.outputFile, original))
+        {
+            std::cerr << "Could not write the output image" << std::endl;
+            return 1;
+        }
+
+        if (options.show)
+            ShowImage("original image", options.inputFile, original);
     }
 
-    windowName = "POBR - original image (" + std::string(argv[1]) + ')';
-    cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
-    cv::imshow(windowName, original);
+#ifndef POBR_HEADLESS
+    if (options.show || options.debug)
+        cv::waitKey(0);
+#endif // POBR_HEADLESS
 
-    cv::waitKey(0);
     return 0;
-}
\ No newline at end of file
+}
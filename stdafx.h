@@ -9,14 +9,30 @@
 #include "targetver.h"
 
 #include <assert.h>
+#include <stdint.h>
+#include <string.h>
 #include <iostream>
 #include <map>
 #include <set>
 #include <vector>
 #include <stack>
 #include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <memory>
+#include <exception>
 
 #include <opencv2/core.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
-#include <opencv2/highgui.hpp>
\ No newline at end of file
+#ifndef POBR_HEADLESS
+#include <opencv2/highgui.hpp>
+#endif // POBR_HEADLESS